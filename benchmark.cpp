@@ -0,0 +1,218 @@
+#include "benchmark.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#include "json.h"
+
+namespace
+{
+	struct NamedStats
+	{
+		std::string name;
+		TimeStats stats;
+	};
+
+	// Frame, CPU and GPU time, then one entry per GPU pass name in the order they first appear,
+	// named gpu_<pass>_ms with spaces turned into underscores.
+	std::vector<NamedStats> frameStats(const BenchmarkReport& report)
+	{
+		std::vector<double> frame, cpu, gpu;
+		std::vector<std::string> passNames;
+		for (const auto& sample : report.frames)
+		{
+			frame.push_back(sample.frameMs);
+			cpu.push_back(sample.cpuMs);
+			gpu.push_back(sample.gpuMs);
+			for (const auto& pass : sample.gpuPasses)
+			{
+				if (std::find(passNames.begin(), passNames.end(), pass.first) == passNames.end())
+					passNames.push_back(pass.first);
+			}
+		}
+
+		std::vector<NamedStats> stats{ { "frame_ms", timeStats(std::move(frame)) }, { "cpu_ms", timeStats(std::move(cpu)) },
+			{ "gpu_ms", timeStats(std::move(gpu)) } };
+		for (const auto& name : passNames)
+		{
+			// - a pass marked twice in a frame counts once with both times added up, frames
+			//   without it count as missing
+			std::vector<double> samples;
+			for (const auto& sample : report.frames)
+			{
+				double ms = -1.0;
+				for (const auto& pass : sample.gpuPasses)
+				{
+					if (pass.first == name)
+						ms = std::max(ms, 0.0) + pass.second;
+				}
+				samples.push_back(ms);
+			}
+			auto key = "gpu_" + name + "_ms";
+			std::replace(key.begin(), key.end(), ' ', '_');
+			stats.push_back({ key, timeStats(std::move(samples)) });
+		}
+		return stats;
+	}
+
+	std::string csvField(const std::string& s)
+	{
+		if (s.find_first_of(",\"\n") == std::string::npos)
+			return s;
+		std::string quoted = "\"";
+		for (const char c : s)
+		{
+			if (c == '"')
+				quoted += '"';
+			quoted += c;
+		}
+		return quoted + '"';
+	}
+}
+
+std::vector<CameraKeyframe> defaultCameraScript()
+{
+	return {
+		{ 0.0f, 1.0f, { 0.0f, 30.0f } },
+		{ 0.25f, 0.75f, { 90.0f, 45.0f } },
+		{ 0.5f, 0.5f, { 180.0f, 60.0f } },
+		{ 0.75f, 0.75f, { 270.0f, 45.0f } },
+		{ 1.0f, 1.0f, { 360.0f, 30.0f } },
+	};
+}
+
+bool loadCameraScript(const std::string& filename, std::vector<CameraKeyframe>& script)
+{
+	std::ifstream in(filename);
+	if (!in)
+		return false;
+
+	script.clear();
+	std::string line;
+	while (std::getline(in, line))
+	{
+		line = line.substr(0, line.find('#'));
+		std::istringstream fields(line);
+		CameraKeyframe key{};
+		if (fields >> key.time >> key.zoom >> key.rotation.x >> key.rotation.y)
+		{
+			if (!script.empty() && key.time < script.back().time)
+				return false;
+			script.push_back(key);
+		}
+		else if (line.find_first_not_of(" \t\r") != std::string::npos)
+			return false;
+	}
+	return !script.empty();
+}
+
+CameraKeyframe sampleCameraScript(std::span<const CameraKeyframe> script, float time)
+{
+	const auto next = std::upper_bound(script.begin(), script.end(), time,
+		[](float t, const CameraKeyframe& key) { return t < key.time; });
+	if (next == script.begin())
+		return script.front();
+	if (next == script.end())
+		return script.back();
+
+	const auto& a = *(next - 1);
+	const auto& b = *next;
+	const float t = (time - a.time) / (b.time - a.time);
+	return { time, glm::mix(a.zoom, b.zoom, t), glm::mix(a.rotation, b.rotation, t) };
+}
+
+TimeStats timeStats(std::vector<double> samples)
+{
+	samples.erase(std::remove_if(samples.begin(), samples.end(), [](double s) { return s < 0.0; }), samples.end());
+	TimeStats stats;
+	stats.samples = samples.size();
+	if (samples.empty())
+		return stats;
+
+	std::sort(samples.begin(), samples.end());
+	const auto percentile = [&](double p) {
+		const auto rank = static_cast<size_t>(std::ceil(p * double(samples.size())));
+		return samples[std::clamp<size_t>(rank, 1, samples.size()) - 1];
+	};
+	stats.min = samples.front();
+	stats.median = percentile(0.5);
+	stats.p95 = percentile(0.95);
+	stats.p99 = percentile(0.99);
+	stats.max = samples.back();
+	double sum = 0.0;
+	for (const double s : samples)
+		sum += s;
+	stats.mean = sum / double(samples.size());
+	return stats;
+}
+
+void printBenchmarkReport(std::ostream& out, const BenchmarkReport& report)
+{
+	out << "Benchmark:";
+	for (const auto& [name, value] : report.config)
+		out << ' ' << name << '=' << value;
+	out << "\nLoad phases (ms):";
+	for (const auto& [name, ms] : report.loadPhases)
+		out << ' ' << name << ' ' << ms;
+	out << "\n\tsamples\tmin\tmedian\tp95\tp99\tmax\tmean\n";
+	for (const auto& [name, stats] : frameStats(report))
+	{
+		out << name << '\t' << stats.samples << '\t' << stats.min << '\t' << stats.median << '\t' << stats.p95 << '\t'
+			<< stats.p99 << '\t' << stats.max << '\t' << stats.mean << '\n';
+	}
+}
+
+bool writeBenchmarkReport(const std::string& filename, const BenchmarkReport& report)
+{
+	std::ofstream out(filename, std::ios::trunc);
+	if (!out)
+		return false;
+
+	out << std::setprecision(6);
+	const auto stats = frameStats(report);
+	if (filename.ends_with(".csv"))
+	{
+		out << "section,name,value\n";
+		for (const auto& [name, value] : report.config)
+			out << "config," << csvField(name) << ',' << csvField(value) << '\n';
+		for (const auto& [name, ms] : report.loadPhases)
+			out << "load_ms," << csvField(name) << ',' << ms << '\n';
+		for (const auto& [name, s] : stats)
+		{
+			out << name << ",samples," << s.samples << '\n' << name << ",min," << s.min << '\n' << name << ",median," << s.median << '\n'
+				<< name << ",p95," << s.p95 << '\n' << name << ",p99," << s.p99 << '\n' << name << ",max," << s.max << '\n'
+				<< name << ",mean," << s.mean << '\n';
+		}
+		return bool(out);
+	}
+
+	out << "{\n\t\"config\": {";
+	for (size_t i = 0; i < report.config.size(); ++i)
+		out << (i ? ", " : "") << jsonString(report.config[i].first) << ": " << jsonString(report.config[i].second);
+	out << "},\n\t\"load_ms\": {";
+	for (size_t i = 0; i < report.loadPhases.size(); ++i)
+		out << (i ? ", " : "") << jsonString(report.loadPhases[i].first) << ": " << report.loadPhases[i].second;
+	out << "},\n";
+	for (const auto& [name, s] : stats)
+	{
+		out << "\t" << jsonString(name) << ": {\"samples\": " << s.samples << ", \"min\": " << s.min << ", \"median\": " << s.median
+			<< ", \"p95\": " << s.p95 << ", \"p99\": " << s.p99 << ", \"max\": " << s.max << ", \"mean\": " << s.mean << "},\n";
+	}
+	// - one [frame, cpu, gpu] triple per measured frame, gpu is null where it was never read back
+	out << "\t\"frames\": [";
+	for (size_t i = 0; i < report.frames.size(); ++i)
+	{
+		const auto& sample = report.frames[i];
+		out << (i ? ", " : "") << '[' << sample.frameMs << ", " << sample.cpuMs << ", ";
+		if (sample.gpuMs < 0.0)
+			out << "null";
+		else
+			out << sample.gpuMs;
+		out << ']';
+	}
+	out << "]\n}\n";
+	return bool(out);
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <ostream>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Camera pose of a scripted benchmark run at `time`, a fraction of the measured frames in
+// [0, 1]. The zoom is relative to the distance the camera starts at, so one script fits a single
+// bunny and every crowd size alike.
+struct CameraKeyframe
+{
+	float time;
+	float zoom;
+	// - yaw and pitch in degrees, as cameraView takes them
+	glm::vec2 rotation;
+};
+
+// One orbit around the model that tilts down and pulls in to half the distance halfway through.
+std::vector<CameraKeyframe> defaultCameraScript();
+
+// Reads one keyframe per line as "time zoom yaw pitch", times increasing; '#' starts a comment.
+bool loadCameraScript(const std::string& filename, std::vector<CameraKeyframe>& script);
+
+// Linear interpolation between the keyframes around `time`, clamped to the first and last.
+CameraKeyframe sampleCameraScript(std::span<const CameraKeyframe> script, float time);
+
+struct FrameSample
+{
+	// - wall time from the start of the frame to the start of the next
+	double frameMs = 0.0;
+	// - CPU time spent recording and submitting the frame, up to the buffer swap
+	double cpuMs = 0.0;
+	// - GPU time from the frame's first command to its last, negative until read back
+	double gpuMs = -1.0;
+	// - the same split into the passes the frame marked
+	std::vector<std::pair<std::string, double>> gpuPasses;
+};
+
+struct TimeStats
+{
+	size_t samples = 0;
+	double min = 0.0;
+	double median = 0.0;
+	double p95 = 0.0;
+	double p99 = 0.0;
+	double max = 0.0;
+	double mean = 0.0;
+};
+
+// Nearest-rank percentiles over `samples`; negative samples count as missing.
+TimeStats timeStats(std::vector<double> samples);
+
+struct BenchmarkReport
+{
+	// - what was measured, as name and value pairs
+	std::vector<std::pair<std::string, std::string>> config;
+	// - startup phases in the order they ran, in milliseconds
+	std::vector<std::pair<std::string, double>> loadPhases;
+	std::vector<FrameSample> frames;
+};
+
+void printBenchmarkReport(std::ostream& out, const BenchmarkReport& report);
+
+// Writes the configuration, load phases, frame and GPU pass time statistics and every frame
+// sample as JSON, or everything but the samples as "section,name,value" rows when `filename`
+// ends in ".csv".
+bool writeBenchmarkReport(const std::string& filename, const BenchmarkReport& report);
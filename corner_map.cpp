@@ -0,0 +1,97 @@
+#include "corner_map.h"
+
+#include <algorithm>
+#include <bit>
+
+namespace
+{
+	// - keep probe sequences short; slots are 16 bytes so a sparse table is still cheap
+	constexpr size_t MAX_LOAD_NUMERATOR = 1;
+	constexpr size_t MAX_LOAD_DENOMINATOR = 2;
+	constexpr size_t MIN_CAPACITY = 16;
+	constexpr int32_t EMPTY = -1;
+}
+
+CornerMapStats& CornerMapStats::operator+=(const CornerMapStats& other)
+{
+	lookups += other.lookups;
+	probes += other.probes;
+	maxProbe = std::max(maxProbe, other.maxProbe);
+	size += other.size;
+	capacity += other.capacity;
+	rehashes += other.rehashes;
+	return *this;
+}
+
+CornerMap::CornerMap(size_t expected)
+{
+	reserve(expected);
+}
+
+void CornerMap::reserve(size_t expected)
+{
+	const size_t capacity = std::bit_ceil(std::max(MIN_CAPACITY, expected * MAX_LOAD_DENOMINATOR / MAX_LOAD_NUMERATOR));
+	if (capacity > slots_.size())
+		rehash(capacity);
+}
+
+uint64_t CornerMap::hash(const CornerKey& key)
+{
+	// - 64-bit finalizer from MurmurHash3 over the packed triple
+	uint64_t h = (uint64_t(uint32_t(key.position)) << 32 | uint32_t(key.texcoord)) ^
+		(uint64_t(uint32_t(key.normal)) * 0x9e3779b97f4a7c15ull);
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdull;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ull;
+	h ^= h >> 33;
+	return h;
+}
+
+std::pair<uint32_t, bool> CornerMap::insert(const CornerKey& key, uint32_t value)
+{
+	if ((stats_.size + 1) * MAX_LOAD_DENOMINATOR > slots_.size() * MAX_LOAD_NUMERATOR)
+	{
+		rehash(std::max(MIN_CAPACITY, slots_.size() * 2));
+		++stats_.rehashes;
+	}
+
+	++stats_.lookups;
+	size_t probe = 1;
+	for (size_t i = hash(key) & mask_;; i = (i + 1) & mask_, ++probe)
+	{
+		auto& slot = slots_[i];
+		if (slot.key.position == EMPTY)
+		{
+			slot = { key, value };
+			++stats_.size;
+			stats_.probes += probe;
+			stats_.maxProbe = std::max(stats_.maxProbe, probe);
+			return { value, true };
+		}
+		if (slot.key == key)
+		{
+			stats_.probes += probe;
+			stats_.maxProbe = std::max(stats_.maxProbe, probe);
+			return { slot.value, false };
+		}
+	}
+}
+
+void CornerMap::rehash(size_t capacity)
+{
+	std::vector<Slot> previous(capacity, Slot{ { EMPTY, EMPTY, EMPTY }, 0 });
+	previous.swap(slots_);
+	mask_ = capacity - 1;
+	stats_.capacity = capacity;
+
+	for (const auto& slot : previous)
+	{
+		if (slot.key.position == EMPTY)
+			continue;
+		size_t i = hash(slot.key) & mask_;
+		while (slots_[i].key.position != EMPTY)
+			i = (i + 1) & mask_;
+		slots_[i] = slot;
+	}
+}
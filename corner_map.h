@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// OBJ face corner: indices into the position, texcoord and normal arrays, -1 when absent.
+struct CornerKey
+{
+	int32_t position;
+	int32_t texcoord;
+	int32_t normal;
+	bool operator==(const CornerKey& other) const {
+		return position == other.position && texcoord == other.texcoord && normal == other.normal;
+	}
+};
+
+struct CornerMapStats
+{
+	size_t lookups = 0;
+	size_t probes = 0;
+	size_t maxProbe = 0;
+	size_t size = 0;
+	size_t capacity = 0;
+	size_t rehashes = 0;
+
+	double averageProbe() const { return lookups ? double(probes) / double(lookups) : 0.0; }
+	double loadFactor() const { return capacity ? double(size) / double(capacity) : 0.0; }
+	CornerMapStats& operator+=(const CornerMapStats& other);
+};
+
+// Open-addressing map from CornerKey to vertex index with linear probing over a flat,
+// power-of-two slot array. Keys must have a valid (non-negative) position index.
+class CornerMap
+{
+public:
+	explicit CornerMap(size_t expected = 0);
+
+	// Sizes the table so `expected` keys stay under the maximum load factor.
+	void reserve(size_t expected);
+
+	// Returns the value stored for `key` and whether it was inserted with `value` just now.
+	std::pair<uint32_t, bool> insert(const CornerKey& key, uint32_t value);
+
+	const CornerMapStats& stats() const { return stats_; }
+	size_t memoryBytes() const { return slots_.capacity() * sizeof(Slot); }
+
+	static uint64_t hash(const CornerKey& key);
+
+private:
+	struct Slot
+	{
+		CornerKey key;
+		uint32_t value;
+	};
+
+	void rehash(size_t capacity);
+
+	std::vector<Slot> slots_;
+	size_t mask_ = 0;
+	CornerMapStats stats_;
+};
@@ -0,0 +1,61 @@
+#include "crowd.h"
+
+#include <cmath>
+#include <limits>
+#include <random>
+
+std::vector<Instance> buildCrowd(size_t count, const glm::vec4& bounds)
+{
+	if (count == 1)
+		return { { glm::vec4(0.0f, 0.0f, 0.0f, 1.0f), glm::vec4(0.0f, 0.0f, 0.0f, 1.0f) } };
+
+	std::vector<Instance> instances;
+	instances.reserve(count);
+
+	// - fixed seed so every run, and every benchmark step, lays out the same crowd
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<float> yaw(0.0f, 6.2831853f);
+	std::uniform_real_distribution<float> scale(0.8f, 1.2f);
+
+	const size_t side = static_cast<size_t>(std::ceil(std::sqrt(double(count))));
+	const float spacing = bounds.w * 2.5f;
+	const float origin = -0.5f * float(side - 1) * spacing;
+	for (size_t i = 0; i < count; ++i)
+	{
+		const float angle = yaw(random) * 0.5f;
+		Instance instance{ glm::vec4(0.0f, 0.0f, 0.0f, scale(random)), glm::vec4(0.0f, std::sin(angle), 0.0f, std::cos(angle)) };
+
+		// - centre each copy's bounding sphere on its grid cell
+		const glm::vec3 cell(origin + float(i % side) * spacing, 0.0f, origin + float(i / side) * spacing);
+		instance.positionScale = glm::vec4(cell - transformPoint(instance, glm::vec3(bounds)), instance.positionScale.w);
+		instances.push_back(instance);
+	}
+	return instances;
+}
+
+glm::vec3 transformPoint(const Instance& instance, const glm::vec3& point)
+{
+	// - same rotation as the vertex shaders: v + 2 q.xyz x (q.xyz x v + q.w v)
+	const glm::vec3 q(instance.rotation);
+	const auto rotated = point + 2.0f * glm::cross(q, glm::cross(q, point) + instance.rotation.w * point);
+	return rotated * instance.positionScale.w + glm::vec3(instance.positionScale);
+}
+
+glm::vec4 crowdBounds(std::span<const Instance> instances, const glm::vec4& bounds)
+{
+	if (instances.empty())
+		return bounds;
+
+	glm::vec3 lower(std::numeric_limits<float>::max());
+	glm::vec3 upper(-std::numeric_limits<float>::max());
+	for (const auto& instance : instances)
+	{
+		const auto center = transformPoint(instance, glm::vec3(bounds));
+		const auto radius = glm::vec3(bounds.w * instance.positionScale.w);
+		lower = glm::min(lower, center - radius);
+		upper = glm::max(upper, center + radius);
+	}
+
+	const auto center = (lower + upper) * 0.5f;
+	return glm::vec4(center, glm::length(upper - center));
+}
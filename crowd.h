@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Per-instance transform the vertex shaders look up by their instanceId vertex attribute, which
+// steps once per instance through the visible list: translation and uniform scale (w), then a
+// unit quaternion (x, y, z, w). 32 bytes, tightly packed in std430.
+struct alignas(16) Instance
+{
+	glm::vec4 positionScale;
+	glm::vec4 rotation;
+};
+
+// - crowd sizes the benchmark steps through
+constexpr size_t CROWD_BENCHMARK_COUNTS[]{ 1, 10, 100, 1000, 10000, 100000, 1000000 };
+
+// Lays out `count` copies of a mesh with bounding sphere `bounds` on a square grid in the XZ
+// plane around the origin, each with a random yaw and a little scale jitter. A single instance
+// is the identity transform.
+std::vector<Instance> buildCrowd(size_t count, const glm::vec4& bounds);
+
+// Instance transform applied to a mesh space point.
+glm::vec3 transformPoint(const Instance& instance, const glm::vec3& point);
+
+// Sphere enclosing every instance's copy of the mesh bounds.
+glm::vec4 crowdBounds(std::span<const Instance> instances, const glm::vec4& bounds);
@@ -0,0 +1,262 @@
+#include "culling.h"
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+
+#include "thread_pool.h"
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define CULL_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// - GCC and Clang only emit AVX2 code in functions marked for it; MSVC accepts the intrinsics anywhere
+#if defined(CULL_X86) && defined(__GNUC__)
+#define CULL_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define CULL_TARGET_AVX2
+#endif
+
+Frustum extractFrustum(const glm::mat4& viewProjection)
+{
+	// - rows of the matrix; glm stores columns
+	const auto row = [&](int i) {
+		return glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+	};
+
+	Frustum frustum{ {
+		row(3) + row(0), // left
+		row(3) - row(0), // right
+		row(3) + row(1), // bottom
+		row(3) - row(1), // top
+		row(3) - row(2), // far
+	} };
+	for (auto& plane : frustum.planes)
+		plane /= glm::length(glm::vec3(plane));
+	return frustum;
+}
+
+bool sphereInFrustum(const Frustum& frustum, const glm::vec4& sphere)
+{
+	for (const auto& plane : frustum.planes)
+	{
+		if (glm::dot(glm::vec3(plane), glm::vec3(sphere)) + plane.w < -sphere.w)
+			return false;
+	}
+	return true;
+}
+
+bool meshletBackfacing(const Meshlet& meshlet, const glm::vec3& cameraPosition)
+{
+	// - the view direction to every point of the sphere must stay inside the cone's complement,
+	//   which the radius term makes conservative for the spread of the triangle positions
+	const auto toCenter = glm::vec3(meshlet.sphere) - cameraPosition;
+	return glm::dot(toCenter, glm::vec3(meshlet.cone)) >= meshlet.cone.w * glm::length(toCenter) + meshlet.sphere.w;
+}
+
+void cullMeshlets(std::span<const Meshlet> meshlets, const Frustum& frustum, const glm::vec3& cameraPosition,
+	std::vector<DrawElementsIndirectCommand>& draws, CullStats* stats /*= nullptr*/)
+{
+	CullStats local;
+	local.meshlets = meshlets.size();
+	for (const auto& meshlet : meshlets)
+	{
+		if (!sphereInFrustum(frustum, meshlet.sphere))
+		{
+			++local.frustumCulled;
+			continue;
+		}
+		if (meshletBackfacing(meshlet, cameraPosition))
+		{
+			++local.backfaceCulled;
+			continue;
+		}
+		draws.push_back({ meshlet.indexCount, 1, meshlet.firstIndex, 0, 0 });
+		local.triangles += meshlet.indexCount / 3;
+	}
+	if (stats)
+		*stats = local;
+}
+
+InstanceBounds buildInstanceBounds(std::span<const Instance> instances, const glm::vec4& meshBounds)
+{
+	InstanceBounds bounds;
+	bounds.x.resize(instances.size());
+	bounds.y.resize(instances.size());
+	bounds.z.resize(instances.size());
+	bounds.radius.resize(instances.size());
+	for (size_t i = 0; i < instances.size(); ++i)
+	{
+		const auto center = transformPoint(instances[i], glm::vec3(meshBounds));
+		bounds.x[i] = center.x;
+		bounds.y[i] = center.y;
+		bounds.z[i] = center.z;
+		bounds.radius[i] = meshBounds.w * instances[i].positionScale.w;
+	}
+	return bounds;
+}
+
+namespace
+{
+	constexpr size_t PLANE_COUNT = std::size(Frustum{}.planes);
+	// - instances per parallelFor item: big enough to amortize the task, small enough to balance
+	constexpr size_t CULL_CHUNK_SIZE = 16384;
+
+	size_t cullScalar(const Frustum& frustum, const InstanceBounds& bounds, size_t begin, size_t end, uint32_t* out)
+	{
+		size_t count = 0;
+		for (size_t i = begin; i < end; ++i)
+		{
+			if (sphereInFrustum(frustum, glm::vec4(bounds.x[i], bounds.y[i], bounds.z[i], bounds.radius[i])))
+				out[count++] = static_cast<uint32_t>(i);
+		}
+		return count;
+	}
+
+	// - appends begin + bit for every set bit of the lane mask
+	size_t emitLanes(unsigned mask, size_t begin, uint32_t* out)
+	{
+		size_t count = 0;
+		while (mask)
+		{
+			out[count++] = static_cast<uint32_t>(begin + std::countr_zero(mask));
+			mask &= mask - 1;
+		}
+		return count;
+	}
+
+#ifdef CULL_X86
+	size_t cullSse(const Frustum& frustum, const InstanceBounds& bounds, size_t begin, size_t end, uint32_t* out)
+	{
+		__m128 planes[PLANE_COUNT][4];
+		for (size_t p = 0; p < PLANE_COUNT; ++p)
+		{
+			for (int c = 0; c < 4; ++c)
+				planes[p][c] = _mm_set1_ps(frustum.planes[p][c]);
+		}
+
+		size_t count = 0;
+		size_t i = begin;
+		for (; i + 4 <= end; i += 4)
+		{
+			const __m128 x = _mm_loadu_ps(&bounds.x[i]);
+			const __m128 y = _mm_loadu_ps(&bounds.y[i]);
+			const __m128 z = _mm_loadu_ps(&bounds.z[i]);
+			const __m128 negativeRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&bounds.radius[i]));
+
+			__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+			for (size_t p = 0; p < PLANE_COUNT; ++p)
+			{
+				const __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planes[p][0], x), _mm_mul_ps(planes[p][1], y)),
+					_mm_add_ps(_mm_mul_ps(planes[p][2], z), planes[p][3]));
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negativeRadius));
+			}
+			count += emitLanes(static_cast<unsigned>(_mm_movemask_ps(inside)), i, out + count);
+		}
+		return count + cullScalar(frustum, bounds, i, end, out + count);
+	}
+
+	CULL_TARGET_AVX2 size_t cullAvx2(const Frustum& frustum, const InstanceBounds& bounds, size_t begin, size_t end, uint32_t* out)
+	{
+		__m256 planes[PLANE_COUNT][4];
+		for (size_t p = 0; p < PLANE_COUNT; ++p)
+		{
+			for (int c = 0; c < 4; ++c)
+				planes[p][c] = _mm256_set1_ps(frustum.planes[p][c]);
+		}
+
+		size_t count = 0;
+		size_t i = begin;
+		for (; i + 8 <= end; i += 8)
+		{
+			const __m256 x = _mm256_loadu_ps(&bounds.x[i]);
+			const __m256 y = _mm256_loadu_ps(&bounds.y[i]);
+			const __m256 z = _mm256_loadu_ps(&bounds.z[i]);
+			const __m256 negativeRadius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(&bounds.radius[i]));
+
+			__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+			for (size_t p = 0; p < PLANE_COUNT; ++p)
+			{
+				const __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(planes[p][0], x), _mm256_mul_ps(planes[p][1], y)),
+					_mm256_add_ps(_mm256_mul_ps(planes[p][2], z), planes[p][3]));
+				inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negativeRadius, _CMP_GE_OQ));
+			}
+			count += emitLanes(static_cast<unsigned>(_mm256_movemask_ps(inside)), i, out + count);
+		}
+		return count + cullSse(frustum, bounds, i, end, out + count);
+	}
+#endif
+}
+
+cull_kernel::type bestCullKernel()
+{
+#ifdef CULL_X86
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 1);
+	const bool osSavesAvx = (info[2] & (1 << 27)) && (_xgetbv(0) & 6) == 6;
+	__cpuidex(info, 7, 0);
+	if (osSavesAvx && (info[1] & (1 << 5)))
+		return cull_kernel::AVX2;
+#else
+	if (__builtin_cpu_supports("avx2"))
+		return cull_kernel::AVX2;
+#endif
+	return cull_kernel::SSE;
+#else
+	return cull_kernel::SCALAR;
+#endif
+}
+
+size_t cullSpheres(const Frustum& frustum, const InstanceBounds& bounds, size_t begin, size_t end, uint32_t* out,
+	cull_kernel::type kernel)
+{
+	switch (kernel)
+	{
+#ifdef CULL_X86
+	case cull_kernel::SSE:
+		return cullSse(frustum, bounds, begin, end, out);
+	case cull_kernel::AVX2:
+		return cullAvx2(frustum, bounds, begin, end, out);
+#endif
+	default:
+		return cullScalar(frustum, bounds, begin, end, out);
+	}
+}
+
+void cullInstances(const Frustum& frustum, const InstanceBounds& bounds, ThreadPool& pool, std::vector<uint32_t>& visible,
+	cull_kernel::type kernel, InstanceCullStats* stats /*= nullptr*/)
+{
+	const auto start = std::chrono::steady_clock::now();
+	const size_t count = bounds.size();
+	const size_t chunks = (count + CULL_CHUNK_SIZE - 1) / CULL_CHUNK_SIZE;
+
+	// - every chunk writes its survivors at its own offset, then they are packed down in order
+	visible.resize(count);
+	std::vector<size_t> survivors(chunks);
+	pool.parallelFor(chunks, [&](size_t chunk) {
+		const size_t begin = chunk * CULL_CHUNK_SIZE;
+		survivors[chunk] = cullSpheres(frustum, bounds, begin, std::min(count, begin + CULL_CHUNK_SIZE), visible.data() + begin, kernel);
+	});
+
+	size_t packed = 0;
+	for (size_t chunk = 0; chunk < chunks; ++chunk)
+	{
+		const auto first = visible.begin() + chunk * CULL_CHUNK_SIZE;
+		std::copy(first, first + survivors[chunk], visible.begin() + packed);
+		packed += survivors[chunk];
+	}
+	visible.resize(packed);
+
+	if (stats)
+	{
+		stats->instances = count;
+		stats->visible = packed;
+		stats->threads = static_cast<unsigned>(std::min<size_t>(pool.size() + 1, std::max<size_t>(chunks, 1)));
+		stats->milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+}
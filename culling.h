@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "crowd.h"
+#include "mesh.h"
+
+class ThreadPool;
+
+// Command layout read by glMultiDrawElementsIndirect.
+struct DrawElementsIndirectCommand
+{
+	uint32_t count;
+	uint32_t instanceCount;
+	uint32_t firstIndex;
+	int32_t baseVertex;
+	uint32_t baseInstance;
+};
+
+// Clip volume planes of a view-projection matrix, normals pointing inwards and normalized so
+// w is a distance. The near plane is left out: the side planes already meet at the eye, so
+// nothing behind the camera passes, and it works with either clip depth convention.
+struct Frustum
+{
+	glm::vec4 planes[5];
+};
+
+Frustum extractFrustum(const glm::mat4& viewProjection);
+
+bool sphereInFrustum(const Frustum& frustum, const glm::vec4& sphere);
+
+// True when every triangle of the meshlet faces away from `cameraPosition` (in mesh space).
+bool meshletBackfacing(const Meshlet& meshlet, const glm::vec3& cameraPosition);
+
+struct CullStats
+{
+	size_t meshlets = 0;
+	size_t frustumCulled = 0;
+	size_t backfaceCulled = 0;
+	size_t triangles = 0;
+};
+
+// Appends one draw command per meshlet that is inside the frustum and not facing away.
+void cullMeshlets(std::span<const Meshlet> meshlets, const Frustum& frustum, const glm::vec3& cameraPosition,
+	std::vector<DrawElementsIndirectCommand>& draws, CullStats* stats = nullptr);
+
+// Instance bounding spheres as structure of arrays, so the culling kernels load 4 or 8 of each
+// component at once.
+struct InstanceBounds
+{
+	std::vector<float> x;
+	std::vector<float> y;
+	std::vector<float> z;
+	std::vector<float> radius;
+	size_t size() const { return x.size(); }
+};
+
+// Transforms the mesh bounding sphere by every instance.
+InstanceBounds buildInstanceBounds(std::span<const Instance> instances, const glm::vec4& meshBounds);
+
+namespace cull_kernel
+{
+	enum type
+	{
+		SCALAR,
+		// - 4 spheres per step, baseline on x86-64
+		SSE,
+		// - 8 spheres per step, picked at run time when the CPU has it
+		AVX2,
+		MAX
+	};
+}
+
+// Widest kernel the CPU running this supports.
+cull_kernel::type bestCullKernel();
+
+struct InstanceCullStats
+{
+	size_t instances = 0;
+	size_t visible = 0;
+	unsigned threads = 1;
+	double milliseconds = 0.0;
+};
+
+// Writes the ids of the spheres in [begin, end) that intersect the frustum to `out`, in order,
+// and returns how many there were.
+size_t cullSpheres(const Frustum& frustum, const InstanceBounds& bounds, size_t begin, size_t end, uint32_t* out,
+	cull_kernel::type kernel);
+
+// Culls all spheres in fixed-size chunks spread over `pool` and compacts the survivors into
+// `visible` in instance order.
+void cullInstances(const Frustum& frustum, const InstanceBounds& bounds, ThreadPool& pool, std::vector<uint32_t>& visible,
+	cull_kernel::type kernel, InstanceCullStats* stats = nullptr);
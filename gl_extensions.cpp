@@ -0,0 +1,16 @@
+#include "gl_extensions.h"
+
+#include <cstring>
+
+bool hasExtension(const char* name)
+{
+	GLint count = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+	for (GLint i = 0; i < count; ++i)
+	{
+		const auto extension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, GLuint(i)));
+		if (extension && std::strcmp(extension, name) == 0)
+			return true;
+	}
+	return false;
+}
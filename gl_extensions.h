@@ -0,0 +1,6 @@
+#pragma once
+
+#include <glad/glad.h>
+
+// Whether the current context exposes the extension `name`, e.g. "GL_EXT_texture_compression_s3tc".
+bool hasExtension(const char* name);
@@ -0,0 +1,92 @@
+#include "gpu_timer.h"
+
+
+double GpuFrame::passMs(std::string_view name) const
+{
+	double ms = 0.0;
+	for (const auto& pass : passes)
+	{
+		if (name == pass.name)
+			ms += pass.ms;
+	}
+	return ms;
+}
+
+GpuTimers::GpuTimers()
+{
+	glCreateQueries(GL_TIMESTAMP, GLsizei(queries_.size()), queries_.data());
+}
+
+GpuTimers::~GpuTimers()
+{
+	glDeleteQueries(GLsizei(queries_.size()), queries_.data());
+}
+
+const GpuFrame* GpuTimers::beginFrame(uint64_t frame)
+{
+	current_ = (current_ + 1) % FRAMES_IN_FLIGHT;
+	auto& slot = slots_[current_];
+	const bool done = slot.pending && read(slot, false);
+	if (slot.pending && !done)
+		++dropped_;
+
+	slot.frame = frame;
+	slot.marks = 0;
+	slot.pending = false;
+	return done ? &latest_ : nullptr;
+}
+
+void GpuTimers::pass(const char* name)
+{
+	auto& slot = slots_[current_];
+	if (slot.marks >= GPU_TIMER_MAX_PASSES)
+		return;
+	slot.names[slot.marks] = name;
+	glQueryCounter(query(current_, slot.marks++), GL_TIMESTAMP);
+}
+
+void GpuTimers::endFrame()
+{
+	auto& slot = slots_[current_];
+	if (slot.marks == 0)
+		return;
+	glQueryCounter(query(current_, slot.marks), GL_TIMESTAMP);
+	slot.pending = true;
+}
+
+std::vector<GpuFrame> GpuTimers::flush()
+{
+	std::vector<GpuFrame> frames;
+	for (size_t i = 1; i <= FRAMES_IN_FLIGHT; ++i)
+	{
+		auto& slot = slots_[(current_ + i) % FRAMES_IN_FLIGHT];
+		if (slot.pending && read(slot, true))
+			frames.push_back(latest_);
+		slot.pending = false;
+	}
+	return frames;
+}
+
+bool GpuTimers::read(Slot& slot, bool wait)
+{
+	const size_t index = size_t(&slot - slots_.data());
+	if (!wait)
+	{
+		// - the end mark was queued last, so once it is available all the others are
+		GLuint available = GL_FALSE;
+		glGetQueryObjectuiv(query(index, slot.marks), GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available)
+			return false;
+	}
+
+	std::array<GLuint64, GPU_TIMER_MAX_PASSES + 1> timestamps{};
+	for (size_t i = 0; i <= slot.marks; ++i)
+		glGetQueryObjectui64v(query(index, i), GL_QUERY_RESULT, &timestamps[i]);
+
+	latest_.frame = slot.frame;
+	latest_.ms = (timestamps[slot.marks] - timestamps[0]) / 1e6;
+	latest_.passes.clear();
+	for (size_t i = 0; i < slot.marks; ++i)
+		latest_.passes.push_back({ slot.names[i], (timestamps[i + 1] - timestamps[i]) / 1e6 });
+	return true;
+}
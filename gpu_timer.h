@@ -0,0 +1,84 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "upload_ring.h"
+
+// - passes one frame can mark before further marks are dropped
+constexpr size_t GPU_TIMER_MAX_PASSES = 16;
+
+struct GpuPass
+{
+	// - the string literal the pass was marked with
+	const char* name;
+	double ms;
+};
+
+// GPU time of one frame, split into the passes it marked.
+struct GpuFrame
+{
+	// - the number the frame was started with
+	uint64_t frame = 0;
+	double ms = 0.0;
+	std::vector<GpuPass> passes;
+
+	// Sum over the passes called `name`, 0 when the frame has none.
+	double passMs(std::string_view name) const;
+};
+
+// Named GPU pass timings from GL_TIMESTAMP queries, kept in a ring FRAMES_IN_FLIGHT frames deep
+// so a frame's results are read back when its slot comes around again instead of stalling on
+// them. Passes are marked in submission order: each mark ends the previous pass, so a frame's
+// passes cover it without gaps. Timestamps rather than GL_TIME_ELAPSED since the latter cannot
+// be nested or interleaved, and llvmpipe leaves compute dispatches out of it.
+class GpuTimers
+{
+public:
+	GpuTimers();
+	~GpuTimers();
+
+	GpuTimers(const GpuTimers&) = delete;
+	GpuTimers& operator=(const GpuTimers&) = delete;
+
+	// Moves to the next slot and returns the frame that used it before, or nullptr when there is
+	// none or its queries are still pending (the frame is then dropped rather than waited for).
+	const GpuFrame* beginFrame(uint64_t frame);
+	// Ends the previous pass, if any, and starts `name`; it must outlive the timers.
+	void pass(const char* name);
+	// Ends the last pass.
+	void endFrame();
+
+	// Reads back every slot still pending, waiting for the GPU, and returns them oldest first.
+	std::vector<GpuFrame> flush();
+
+	// - the most recent frame read back
+	const GpuFrame& latest() const { return latest_; }
+	// - frames whose results were still pending when their slot came around again
+	size_t dropped() const { return dropped_; }
+
+private:
+	struct Slot
+	{
+		uint64_t frame = 0;
+		// - marks so far, the last one ends the frame
+		size_t marks = 0;
+		std::array<const char*, GPU_TIMER_MAX_PASSES> names{};
+		bool pending = false;
+	};
+
+	bool read(Slot& slot, bool wait);
+	GLuint query(size_t slot, size_t mark) const { return queries_[slot * (GPU_TIMER_MAX_PASSES + 1) + mark]; }
+
+	std::array<GLuint, FRAMES_IN_FLIGHT * (GPU_TIMER_MAX_PASSES + 1)> queries_{};
+	std::array<Slot, FRAMES_IN_FLIGHT> slots_{};
+	size_t current_ = 0;
+	GpuFrame latest_;
+	size_t dropped_ = 0;
+};
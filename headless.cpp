@@ -0,0 +1,107 @@
+#include "headless.h"
+
+#include <iostream>
+
+#ifdef __linux__
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#else
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>
+#endif
+
+HeadlessContext::~HeadlessContext()
+{
+	destroy();
+}
+
+#ifdef __linux__
+bool HeadlessContext::create(int major, int minor)
+{
+	// - the surfaceless platform needs no X11 or Wayland connection; the default display is the
+	//   fallback for EGL implementations without it
+	const auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+	EGLDisplay display = getPlatformDisplay ? getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr) : EGL_NO_DISPLAY;
+	if (display == EGL_NO_DISPLAY)
+		display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr))
+	{
+		std::cerr << "Failed to initialize an EGL display\n";
+		return false;
+	}
+	display_ = display;
+
+	// - no config and no surface: everything is drawn into framebuffer objects
+	const EGLint attributes[]{
+		EGL_CONTEXT_MAJOR_VERSION, major,
+		EGL_CONTEXT_MINOR_VERSION, minor,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE
+	};
+	EGLContext context = EGL_NO_CONTEXT;
+	if (eglBindAPI(EGL_OPENGL_API))
+		context = eglCreateContext(display, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, attributes);
+	if (context == EGL_NO_CONTEXT)
+	{
+		std::cerr << "Failed to create an OpenGL " << major << "." << minor << " core context through EGL\n";
+		return false;
+	}
+	context_ = context;
+	return eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context) == EGL_TRUE;
+}
+
+void HeadlessContext::destroy()
+{
+	if (context_)
+	{
+		eglMakeCurrent(display_, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		eglDestroyContext(display_, context_);
+		context_ = nullptr;
+	}
+	if (display_)
+	{
+		eglTerminate(display_);
+		display_ = nullptr;
+	}
+}
+
+void* HeadlessContext::procAddress(const char* name)
+{
+	return reinterpret_cast<void*>(eglGetProcAddress(name));
+}
+#else
+bool HeadlessContext::create(int major, int minor)
+{
+	if (!glfwInit())
+		return false;
+
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, major);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, minor);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	window_ = glfwCreateWindow(1, 1, "Rabbit", nullptr, nullptr);
+	if (!window_)
+	{
+		std::cerr << "Failed to create an invisible GLFW window\n";
+		glfwTerminate();
+		return false;
+	}
+	glfwMakeContextCurrent(window_);
+	return true;
+}
+
+void HeadlessContext::destroy()
+{
+	if (window_)
+	{
+		glfwDestroyWindow(window_);
+		glfwTerminate();
+		window_ = nullptr;
+	}
+}
+
+void* HeadlessContext::procAddress(const char* name)
+{
+	return reinterpret_cast<void*>(glfwGetProcAddress(name));
+}
+#endif
@@ -0,0 +1,34 @@
+#pragma once
+
+#ifndef __linux__
+struct GLFWwindow;
+#endif
+
+// OpenGL core context without a window. On Linux it is an EGL context on Mesa's surfaceless
+// platform, so it needs neither a display server nor a GPU (llvmpipe will do); elsewhere it is
+// an invisible GLFW window. There is no default framebuffer to draw to either way, so the
+// caller renders into its own.
+class HeadlessContext
+{
+public:
+	HeadlessContext() = default;
+	~HeadlessContext();
+
+	HeadlessContext(const HeadlessContext&) = delete;
+	HeadlessContext& operator=(const HeadlessContext&) = delete;
+
+	// Creates the context and makes it current on the calling thread.
+	bool create(int major, int minor);
+	void destroy();
+
+	// - for gladLoadGLLoader
+	static void* procAddress(const char* name);
+
+private:
+#ifdef __linux__
+	void* display_ = nullptr;
+	void* context_ = nullptr;
+#else
+	GLFWwindow* window_ = nullptr;
+#endif
+};
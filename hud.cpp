@@ -0,0 +1,184 @@
+#include "hud.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <vector>
+
+#include <stb_easy_font.h>
+
+namespace
+{
+	// Vertex layout stb_easy_font_print writes.
+	struct HudVertex
+	{
+		float x, y, z;
+		unsigned char color[4];
+	};
+	static_assert(sizeof(HudVertex) == Hud::VERTEX_BYTES);
+	static_assert(HUD_MAX_QUADS * 4 <= 65536, "quad indices are 16 bit");
+
+	// - overlay units: margin to the framebuffer edge, padding inside the panel, graph height
+	constexpr float HUD_MARGIN = 4.0f;
+	constexpr float HUD_PADDING = 4.0f;
+	constexpr float HUD_GRAPH_HEIGHT = 48.0f;
+	// - the graph's scale starts at one 60 Hz frame and doubles until the slowest frame fits
+	constexpr float HUD_GRAPH_MIN_MS = 1000.0f / 60.0f;
+
+	constexpr unsigned char PANEL_COLOR[4]{ 0, 0, 0, 160 };
+	constexpr unsigned char TEXT_COLOR[4]{ 255, 255, 255, 255 };
+	constexpr unsigned char GRID_COLOR[4]{ 255, 255, 255, 48 };
+	constexpr unsigned char CPU_COLOR[4]{ 96, 208, 96, 255 };
+	constexpr unsigned char GPU_COLOR[4]{ 255, 160, 48, 255 };
+
+	class QuadWriter
+	{
+	public:
+		explicit QuadWriter(HudVertex* vertices) : vertices_(vertices) {}
+
+		void quad(float x0, float y0, float x1, float y1, const unsigned char (&color)[4])
+		{
+			if (count_ >= HUD_MAX_QUADS)
+				return;
+			HudVertex* v = vertices_ + count_++ * 4;
+			v[0] = { x0, y0, 0.0f, { color[0], color[1], color[2], color[3] } };
+			v[1] = { x1, y0, 0.0f, { color[0], color[1], color[2], color[3] } };
+			v[2] = { x1, y1, 0.0f, { color[0], color[1], color[2], color[3] } };
+			v[3] = { x0, y1, 0.0f, { color[0], color[1], color[2], color[3] } };
+		}
+
+		void text(float x, float y, const char* text, const unsigned char (&color)[4])
+		{
+			// - stb_easy_font takes neither const text nor const color, but writes to neither
+			unsigned char rgba[4]{ color[0], color[1], color[2], color[3] };
+			count_ += size_t(stb_easy_font_print(x, y, const_cast<char*>(text), rgba, vertices_ + count_ * 4,
+				int((HUD_MAX_QUADS - count_) * 4 * sizeof(HudVertex))));
+		}
+
+		size_t count() const { return count_; }
+
+	private:
+		HudVertex* vertices_;
+		size_t count_ = 0;
+	};
+}
+
+Hud::Hud(GLuint program, GLuint pipeline)
+	: program_(program)
+	, pipeline_(pipeline)
+{
+	// - two triangles per quad over the corners stb_easy_font emits in order
+	std::vector<uint16_t> indices(HUD_MAX_QUADS * 6);
+	for (size_t i = 0; i < HUD_MAX_QUADS; ++i)
+	{
+		const auto first = static_cast<uint16_t>(i * 4);
+		const uint16_t quad[6]{ first, uint16_t(first + 1), uint16_t(first + 2), first, uint16_t(first + 2), uint16_t(first + 3) };
+		std::copy(std::begin(quad), std::end(quad), indices.begin() + i * 6);
+	}
+	glCreateBuffers(1, &indices_);
+	glNamedBufferStorage(indices_, indices.size() * sizeof(uint16_t), indices.data(), 0);
+
+	glCreateVertexArrays(1, &vao_);
+	glVertexArrayElementBuffer(vao_, indices_);
+	glEnableVertexArrayAttrib(vao_, 0);
+	glVertexArrayAttribFormat(vao_, 0, 2, GL_FLOAT, GL_FALSE, offsetof(HudVertex, x));
+	glVertexArrayAttribBinding(vao_, 0, 0);
+	glEnableVertexArrayAttrib(vao_, 1);
+	glVertexArrayAttribFormat(vao_, 1, 4, GL_UNSIGNED_BYTE, GL_TRUE, offsetof(HudVertex, color));
+	glVertexArrayAttribBinding(vao_, 1, 0);
+}
+
+Hud::~Hud()
+{
+	glDeleteVertexArrays(1, &vao_);
+	glDeleteBuffers(1, &indices_);
+}
+
+void Hud::cpuFrame(uint64_t frame, double ms)
+{
+	history_[frame % HUD_HISTORY] = { frame, float(ms), -1.0f };
+	newest_ = std::max(newest_, frame);
+}
+
+void Hud::gpuFrame(uint64_t frame, double ms)
+{
+	auto& column = history_[frame % HUD_HISTORY];
+	if (column.frame == frame)
+		column.gpuMs = float(ms);
+}
+
+bool Hud::draw(UploadRing& uploads, const std::string& text, int width, int height)
+{
+	UploadRing::Allocation allocation;
+	auto vertices = uploads.allocate<HudVertex>(allocation, HUD_MAX_QUADS * 4);
+	if (!vertices)
+		return false;
+
+	// - the graph's scale fits the slowest frame still in it
+	float graphMs = HUD_GRAPH_MIN_MS;
+	for (const auto& column : history_)
+	{
+		while (graphMs < column.cpuMs || graphMs < column.gpuMs)
+			graphMs *= 2.0f;
+	}
+	char range[32];
+	std::snprintf(range, sizeof(range), "0 - %.1f ms", graphMs);
+
+	char* const chars = const_cast<char*>(text.c_str());
+	const float textWidth = float(stb_easy_font_width(chars));
+	const float textHeight = float(stb_easy_font_height(chars));
+	const float legendTop = HUD_MARGIN + HUD_PADDING + textHeight + HUD_PADDING;
+	const float graphLeft = HUD_MARGIN + HUD_PADDING;
+	const float graphTop = legendTop + float(stb_easy_font_height(range)) + HUD_PADDING;
+	const float graphBottom = graphTop + HUD_GRAPH_HEIGHT;
+	const float panelRight = HUD_MARGIN + HUD_PADDING + std::max(textWidth, float(HUD_HISTORY)) + HUD_PADDING;
+
+	QuadWriter quads(vertices);
+	quads.quad(HUD_MARGIN, HUD_MARGIN, panelRight, graphBottom + HUD_PADDING, PANEL_COLOR);
+	quads.text(HUD_MARGIN + HUD_PADDING, HUD_MARGIN + HUD_PADDING, text.c_str(), TEXT_COLOR);
+
+	// - legend swatches in front of their labels, then quarter lines across the graph
+	quads.quad(graphLeft, legendTop, graphLeft + 5.0f, legendTop + 5.0f, CPU_COLOR);
+	quads.text(graphLeft + 8.0f, legendTop, "CPU", TEXT_COLOR);
+	quads.quad(graphLeft + 32.0f, legendTop, graphLeft + 37.0f, legendTop + 5.0f, GPU_COLOR);
+	quads.text(graphLeft + 40.0f, legendTop, "GPU", TEXT_COLOR);
+	quads.text(graphLeft + 72.0f, legendTop, range, TEXT_COLOR);
+	for (int i = 0; i <= 4; ++i)
+	{
+		const float y = graphBottom - HUD_GRAPH_HEIGHT * float(i) / 4.0f;
+		quads.quad(graphLeft, y - 1.0f, graphLeft + float(HUD_HISTORY), y, GRID_COLOR);
+	}
+
+	// - oldest frame on the left; CPU time as bars, GPU time as a mark at its height
+	const float unitsPerMs = HUD_GRAPH_HEIGHT / graphMs;
+	for (size_t i = 0; i < HUD_HISTORY && i <= newest_; ++i)
+	{
+		const uint64_t frame = newest_ - i;
+		const auto& column = history_[frame % HUD_HISTORY];
+		if (column.frame != frame || column.cpuMs < 0.0f)
+			continue;
+		const float x = graphLeft + float(HUD_HISTORY - 1 - i);
+		quads.quad(x, graphBottom - column.cpuMs * unitsPerMs, x + 1.0f, graphBottom, CPU_COLOR);
+		if (column.gpuMs >= 0.0f)
+		{
+			const float y = graphBottom - column.gpuMs * unitsPerMs;
+			quads.quad(x, y - 1.0f, x + 1.0f, y, GPU_COLOR);
+		}
+	}
+
+	// - whole overlay units, at least one framebuffer pixel each and two from 1080 lines up
+	const float scale = float(std::max(1, height / 540));
+	const GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+	glDisable(GL_DEPTH_TEST);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glBindProgramPipeline(pipeline_);
+	glProgramUniform2f(program_, 0, 2.0f * scale / float(width), 2.0f * scale / float(height));
+	glVertexArrayVertexBuffer(vao_, 0, uploads.buffer(), allocation.offset, sizeof(HudVertex));
+	glBindVertexArray(vao_);
+	glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(quads.count() * 6), GL_UNSIGNED_SHORT, nullptr);
+	glDisable(GL_BLEND);
+	if (depthTest)
+		glEnable(GL_DEPTH_TEST);
+	return true;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include <glad/glad.h>
+
+#include "upload_ring.h"
+
+// - frames shown by the frame-time graph, one column each
+constexpr size_t HUD_HISTORY = 240;
+// - quads one frame may draw: stb_easy_font spends one per stroke, a few per character
+constexpr size_t HUD_MAX_QUADS = 8192;
+
+// Performance overlay: a text panel and a rolling CPU/GPU frame-time graph, drawn with
+// stb_easy_font quads streamed through the upload ring each frame. Text and graph are laid out in
+// overlay units of one font pixel, scaled up with the framebuffer height.
+class Hud
+{
+public:
+	// - stb_easy_font's vertex: x, y, z, then RGBA8
+	static constexpr size_t VERTEX_BYTES = 16;
+	// - upload ring bytes draw() allocates per frame
+	static constexpr size_t FRAME_BYTES = HUD_MAX_QUADS * 4 * VERTEX_BYTES;
+
+	// Uses the separable program and pipeline built from vs_hud_source and fs_hud_source, which
+	// stay owned by the caller.
+	Hud(GLuint program, GLuint pipeline);
+	~Hud();
+
+	Hud(const Hud&) = delete;
+	Hud& operator=(const Hud&) = delete;
+
+	// Starts the graph column of `frame` with the CPU time it took to submit.
+	void cpuFrame(uint64_t frame, double ms);
+	// Fills in the GPU time of `frame` once the timers read it back; frames that already left
+	// the graph are ignored.
+	void gpuFrame(uint64_t frame, double ms);
+
+	// Draws `text` (lines separated by '\n') and the graph below it over the bound framebuffer.
+	// Returns false when the ring had no room left for the vertices.
+	bool draw(UploadRing& uploads, const std::string& text, int width, int height);
+
+private:
+	struct Column
+	{
+		uint64_t frame = 0;
+		float cpuMs = -1.0f;
+		// - negative until the timers read the frame back
+		float gpuMs = -1.0f;
+	};
+
+	GLuint program_ = 0;
+	GLuint pipeline_ = 0;
+	GLuint vao_ = 0;
+	GLuint indices_ = 0;
+	std::array<Column, HUD_HISTORY> history_{};
+	uint64_t newest_ = 0;
+};
@@ -0,0 +1,113 @@
+#include "impostor.h"
+
+#include <cstring>
+
+#include <glm/ext/matrix_clip_space.hpp>
+#include <glm/ext/matrix_transform.hpp>
+
+namespace
+{
+	constexpr uint32_t IMPOSTOR_CACHE_MAGIC = 0x49594e42; // "BNYI"
+	constexpr uint32_t IMPOSTOR_CACHE_VERSION = 2;
+
+	struct ImpostorCacheHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t grid;
+		uint32_t cellSize;
+		// - how the atlas was baked, see impostor_bake
+		uint32_t flags;
+		uint32_t reserved;
+		uint64_t modelSize;
+		int64_t modelTime;
+		uint64_t textureSize;
+		int64_t textureTime;
+	};
+
+	// - sign that maps 0 to 1 so the octahedral fold never collapses an axis
+	glm::vec2 signNotZero(glm::vec2 v)
+	{
+		return { v.x >= 0.0f ? 1.0f : -1.0f, v.y >= 0.0f ? 1.0f : -1.0f };
+	}
+}
+
+glm::vec3 octahedralDecode(glm::vec2 e)
+{
+	glm::vec3 n(e.x, 1.0f - glm::abs(e.x) - glm::abs(e.y), e.y);
+	if (n.y < 0.0f)
+	{
+		const glm::vec2 folded = (1.0f - glm::abs(glm::vec2(n.z, n.x))) * signNotZero(glm::vec2(n.x, n.z));
+		n.x = folded.x;
+		n.z = folded.y;
+	}
+	return glm::normalize(n);
+}
+
+glm::vec2 octahedralEncode(glm::vec3 direction)
+{
+	const glm::vec3 n = direction / (glm::abs(direction.x) + glm::abs(direction.y) + glm::abs(direction.z));
+	glm::vec2 e(n.x, n.z);
+	if (n.y < 0.0f)
+		e = (1.0f - glm::abs(glm::vec2(e.y, e.x))) * signNotZero(e);
+	return e;
+}
+
+glm::mat4 impostorViewProjection(uint32_t x, uint32_t y, uint32_t grid, const glm::vec4& bounds)
+{
+	const glm::vec2 cell = (glm::vec2(float(x), float(y)) + 0.5f) / float(grid);
+	const glm::vec3 direction = octahedralDecode(cell * 2.0f - 1.0f);
+	const glm::vec3 center(bounds);
+	const float radius = bounds.w;
+
+	// - the up hint is swapped near the poles; the impostor vertex shader builds the same basis
+	const glm::vec3 up = glm::abs(direction.y) > 0.999f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+	const glm::mat4 view = glm::lookAtRH(center + direction * 2.0f * radius, center, up);
+	const glm::mat4 projection = glm::orthoRH_NO(-radius, radius, -radius, radius, radius, 3.0f * radius);
+	return projection * view;
+}
+
+bool readImpostorCache(const std::string& filename, const FileStamp& model, const FileStamp& texture, uint32_t flags,
+	ImpostorAtlas& atlas)
+{
+	MappedFile file;
+	if (!file.open(filename) || file.size() < sizeof(ImpostorCacheHeader))
+		return false;
+
+	ImpostorCacheHeader header{};
+	std::memcpy(&header, file.data(), sizeof(header));
+	if (header.magic != IMPOSTOR_CACHE_MAGIC || header.version != IMPOSTOR_CACHE_VERSION ||
+		header.grid != atlas.grid || header.cellSize != atlas.cellSize || header.flags != flags ||
+		header.modelSize != model.size || header.modelTime != model.time ||
+		header.textureSize != texture.size || header.textureTime != texture.time)
+		return false;
+
+	const size_t texels = size_t(atlas.size()) * atlas.size();
+	if (file.size() != sizeof(header) + texels * (sizeof(uint32_t) + sizeof(uint16_t)))
+		return false;
+
+	atlas.color.resize(texels);
+	atlas.depth.resize(texels);
+	std::memcpy(atlas.color.data(), file.data() + sizeof(header), texels * sizeof(uint32_t));
+	std::memcpy(atlas.depth.data(), file.data() + sizeof(header) + texels * sizeof(uint32_t), texels * sizeof(uint16_t));
+	return true;
+}
+
+bool writeImpostorCache(const std::string& filename, const FileStamp& model, const FileStamp& texture, uint32_t flags,
+	const ImpostorAtlas& atlas)
+{
+	ImpostorCacheHeader header{};
+	header.magic = IMPOSTOR_CACHE_MAGIC;
+	header.version = IMPOSTOR_CACHE_VERSION;
+	header.grid = atlas.grid;
+	header.cellSize = atlas.cellSize;
+	header.flags = flags;
+	header.modelSize = model.size;
+	header.modelTime = model.time;
+	header.textureSize = texture.size;
+	header.textureTime = texture.time;
+
+	const std::span<const std::byte> parts[] = { std::as_bytes(std::span(&header, 1)), std::as_bytes(std::span(atlas.color)),
+		std::as_bytes(std::span(atlas.depth)) };
+	return writeFileReplacing(filename, parts);
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "mapped_file.h"
+
+// - views per side of the octahedral atlas and texels per side of each view
+constexpr uint32_t IMPOSTOR_GRID = 16;
+constexpr uint32_t IMPOSTOR_CELL_SIZE = 64;
+
+// What an atlas was baked from besides the model and texture files, checked by readImpostorCache.
+namespace impostor_bake
+{
+	enum type : uint32_t
+	{
+		// - quantized positions and texture coordinates of the compact vertex format
+		COMPACT_VERTICES = 1 << 0,
+		// - the BC1/BC3 texture rather than the RGBA8 one
+		COMPRESSED_TEXTURE = 1 << 1
+	};
+}
+
+// Color and depth of a mesh seen from IMPOSTOR_GRID x IMPOSTOR_GRID directions laid out over an
+// octahedral map, one orthographic view of the bounding sphere per cell.
+struct ImpostorAtlas
+{
+	uint32_t grid = IMPOSTOR_GRID;
+	uint32_t cellSize = IMPOSTOR_CELL_SIZE;
+	// - RGBA8 texels, alpha is coverage
+	std::vector<uint32_t> color;
+	// - distance into the bounding sphere along the view direction, 0 at the side facing the
+	//   view and 1 at the far side
+	std::vector<uint16_t> depth;
+
+	uint32_t size() const { return grid * cellSize; }
+};
+
+// Unit direction for a point of the octahedral map in [-1, 1]^2, +y at the center.
+glm::vec3 octahedralDecode(glm::vec2 e);
+
+// Point of the octahedral map in [-1, 1]^2 for a direction.
+glm::vec2 octahedralEncode(glm::vec3 direction);
+
+// Orthographic view-projection of the atlas cell (x, y): looking at the bounding sphere
+// `bounds` from the cell's direction, with the depth range spanning the sphere and clip space
+// depth in [-1, 1] so the depth buffer holds the linear distance the atlas stores.
+glm::mat4 impostorViewProjection(uint32_t x, uint32_t y, uint32_t grid, const glm::vec4& bounds);
+
+// Loads the atlas baked for `model` and `texture` with the impostor_bake `flags` from `filename`,
+// failing when it is missing, older than either source, or baked with other flags or atlas
+// dimensions.
+bool readImpostorCache(const std::string& filename, const FileStamp& model, const FileStamp& texture, uint32_t flags,
+	ImpostorAtlas& atlas);
+
+bool writeImpostorCache(const std::string& filename, const FileStamp& model, const FileStamp& texture, uint32_t flags,
+	const ImpostorAtlas& atlas);
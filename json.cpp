@@ -0,0 +1,31 @@
+#include "json.h"
+
+#include <cstdio>
+
+std::string jsonString(std::string_view s)
+{
+	std::string quoted = "\"";
+	for (const char c : s)
+	{
+		switch (c)
+		{
+		case '"':   quoted += "\\\""; break;
+		case '\\':  quoted += "\\\\"; break;
+		case '\n':  quoted += "\\n"; break;
+		case '\r':  quoted += "\\r"; break;
+		case '\t':  quoted += "\\t"; break;
+		default:
+			if (static_cast<unsigned char>(c) < 0x20)
+			{
+				char escaped[7];
+				std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned>(static_cast<unsigned char>(c)));
+				quoted += escaped;
+			}
+			else
+			{
+				quoted += c;
+			}
+		}
+	}
+	return quoted + '"';
+}
@@ -0,0 +1,8 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+// `s` as a quoted JSON string: quotes, backslashes and control characters are escaped, other
+// bytes (UTF-8 included) pass through.
+std::string jsonString(std::string_view s);
@@ -5,7 +5,15 @@
 #include <string>
 #include <string_view>
 #include <tuple>
-#include <unordered_map>
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <numeric>
 
 #include <glad/glad.h>
 
@@ -17,13 +25,27 @@
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/glm.hpp>
 #include <glm/ext.hpp>
-#include <glm/gtx/hash.hpp>
-
-#define TINYOBJLOADER_IMPLEMENTATION
-#include <tiny_obj_loader.h>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image_write.h>
+
+#include "benchmark.h"
+#include "crowd.h"
+#include "culling.h"
+#include "gpu_timer.h"
+#include "headless.h"
+#include "hud.h"
+#include "impostor.h"
+#include "mesh.h"
+#include "process_stats.h"
+#include "profile.h"
+#include "program_cache.h"
+#include "shader_builder.h"
+#include "texture_stream.h"
+#include "thread_pool.h"
+#include "upload_ring.h"
 
 // Function prototypes
 void error_callback(int error, const char* description);
@@ -32,70 +54,290 @@ void mouse_button_callback(GLFWwindow* window, int button, int action, int mods)
 void cursor_position_callback(GLFWwindow* window, double x, double y);
 void scroll_callback(GLFWwindow* window, double x, double y);
 
-void checkShader(GLuint shader);
-void checkProgram(GLuint program);
-GLuint createShader(std::string_view source, GLenum shaderType);
-std::tuple<GLuint, GLuint> createShaderProgram(std::array<std::string_view, 2> const& source);
-GLuint createTexture2D(GLenum internalformat, GLsizei width, GLsizei height, GLenum format, void* data = nullptr,
-	GLenum minFilter = GL_LINEAR, GLenum magFilter = GL_LINEAR, GLenum wrapMode = GL_REPEAT);
-using stb_comp_t = decltype(STBI_default);
-GLuint loadTexture(std::string_view filename, stb_comp_t comp = STBI_rgb_alpha);
-void loadModel(const std::string& filename);
 glm::mat4 camera(float zoom, const glm::vec2& rotate);
+glm::mat4 cameraView(float zoom, const glm::vec2& rotate);
+GLuint createDepthPyramid(GLsizei width, GLsizei height);
+ImpostorAtlas renderImpostorAtlas(GLuint pipeline, GLuint vao, GLuint vertexBuffer, GLuint texture, const Mesh& mesh,
+	const glm::vec4& bounds);
+std::array<GLuint, 2> createImpostorTextures(const ImpostorAtlas& atlas);
+void buildDepthPyramid(GLuint program, GLuint pipeline, GLuint depth, GLuint pyramid, GLsizei width, GLsizei height);
+void frameCrowd(const glm::vec4& bounds);
+int runCullBenchmark();
+double elapsedSeconds();
+bool writeFrame(GLuint texture, int width, int height, const std::string& filename);
+
+namespace crowd_culling
+{
+	enum type
+	{
+		// - draw every instance
+		NONE,
+		// - SIMD frustum test over all threads, visible ids uploaded through the ring
+		CPU,
+		// - compute pass writes the visible ids and draw commands, picking a level per instance
+		GPU,
+		// - GPU culling in two passes around a depth pyramid: last frame's visible set is drawn
+		//   first, then everything else is tested against the depth it left behind
+		OCCLUSION,
+		MAX
+	};
+}
+
+namespace mesh_shading
+{
+	enum type
+	{
+		// - the diffuse texture, what the model looks like
+		TEXTURE,
+		// - vertex colors, white for compact vertices which have none
+		COLOR,
+		// - a constant color; vertices only fetch their positions
+		FLAT,
+		MAX
+	};
+}
 
 constexpr int WIDTH{1920};
 constexpr int HEIGHT{1080};
+
+struct Options
+{
+	ModelOptions model;
+	vertex_format::type vertexFormat = vertex_format::FULL;
+	// - largest simplification error, in pixels, a level of detail may show on screen
+	float lodErrorPixels = 1.0f;
+	// - draw this level of detail instead of picking one per frame, -1 to select by screen size
+	int forcedLod = -1;
+	// - cull meshlets on the CPU and draw the survivors with one multi-draw, otherwise draw whole levels
+	bool meshletCulling = true;
+	// - copies of the bunny drawn with one instanced draw; meshlet culling only applies to a single one
+	size_t crowd = 1;
+	// - step through CROWD_BENCHMARK_COUNTS, print the frame times and exit
+	bool crowdBenchmark = false;
+	crowd_culling::type crowdCulling = crowd_culling::GPU;
+	mesh_shading::type shading = mesh_shading::TEXTURE;
+	// - time the CPU culling kernels on a million instances and exit without opening a window
+	bool cullBenchmark = false;
+	// - projected diameter in pixels at or below which GPU culled instances are drawn as
+	//   impostors, 0 to always draw the mesh
+	float impostorSize = float(IMPOSTOR_CELL_SIZE);
+	// - render into a framebuffer object of width x height without opening a window
+	bool headless = false;
+	int width = WIDTH;
+	int height = HEIGHT;
+	// - frames to render before exiting, 0 to run until the window closes (a single frame when headless)
+	size_t frames = 0;
+	// - write every frame to <prefix>NNNNN.png when not empty
+	std::string dumpPrefix;
+	// - play the camera script over this many timed frames after the warm-up, report and exit
+	size_t benchmarkFrames = 0;
+	size_t warmupFrames = 60;
+	// - keyframe file for the scripted benchmark, the built-in orbit when empty
+	std::string cameraScript;
+	// - JSON, or CSV for a .csv name, written at the end of the scripted benchmark
+	std::string reportFile;
+	// - draw the performance overlay over every frame
+	bool hud = true;
+	// - record profiling zones and write them as a Chrome trace on exit when not empty
+	std::string traceFile;
+	// - reuse linked program binaries from PROGRAM_CACHE_DIRECTORY instead of compiling
+	bool programCache = true;
+	// - sample a BC1/BC3 mip chain cooked on the CPU and cached next to the image, instead of
+	//   uncompressed RGBA8
+	bool textureCompression = true;
+	// - bytes of texture data uploaded per frame at most while textures stream in, 0 for no limit
+	size_t textureBudget = 256 * 1024;
+};
+
+// - where ProgramCache keeps the linked program binaries, relative to the working directory
+const char* const PROGRAM_CACHE_DIRECTORY = "shader_cache";
+
+Options parseOptions(int argc, char* argv[]);
+
+constexpr float FIELD_OF_VIEW{45.0f};
+constexpr float NEAR_PLANE{0.1f};
+float aspectRatio = float(WIDTH) / float(HEIGHT);
 glm::vec2 rotation = glm::vec2(0.0f, 0.0f);
 float zoom = 40.0f;
+float farPlane = 100.0f;
 double cursorX;
 double cursorY;
 
-struct alignas(16) Vertex
+struct UniformBufferObject
 {
-	glm::vec4 position;
-	glm::vec4 color;
-	glm::vec2 texcoord;
-	bool operator==(const Vertex& other) const {
-		return position == other.position && color == other.color && texcoord == other.texcoord;
-	}
+	glm::mat4 ViewProjection;
+	// - camera position, near plane distance in w
+	glm::vec4 CameraPosition;
+	glm::vec4 MeshBounds;
+	// - screen pixels per unit at a distance of one unit, then the projected diameters in pixels
+	//   at or below which only the impostor and at or above which only the mesh is drawn; a zero
+	//   impostor diameter turns the cross-fade off
+	glm::vec4 Impostor;
 };
 
-namespace std {
-	template<> struct hash<Vertex> {
-		size_t operator()(Vertex const& vertex) const {
-			return ((hash<glm::vec3>()(vertex.position) ^
-				(hash<glm::vec3>()(vertex.color) << 1)) >> 1) ^
-				(hash<glm::vec2>()(vertex.texcoord) << 1);
-		}
+// - the mesh is drawn alone again once its projected diameter is this much above the impostor size
+constexpr float IMPOSTOR_FADE_RANGE = 1.5f;
+
+namespace cull_pass
+{
+	enum type
+	{
+		// - frustum test only
+		FRUSTUM,
+		// - instances the previous frame found visible, before the depth pyramid is built
+		EARLY,
+		// - the rest, tested against the depth pyramid, updating the visibility flags
+		LATE,
+		MAX
 	};
 }
 
-std::vector<Vertex> vertices;
-std::vector<uint32_t> indices;
-
-struct UniformBufferObject
+// CullParams block of cs_cull_source, std140.
+struct CullUniforms
 {
-	glm::mat4 MVP;
+	glm::vec4 planes[5];
+	// - camera position, near plane distance in w
+	glm::vec4 cameraPosition;
+	glm::vec4 meshBounds;
+	glm::mat4 view;
+	// - P[0][0], P[1][1], P[2][2] and P[3][2] of the projection
+	glm::vec4 projection;
+	// - screen pixels per unit at a distance of one unit
+	float pixelsPerUnit;
+	float maxErrorPixels;
+	int32_t forcedLod;
+	uint32_t lodCount;
+	uint32_t instanceCount;
+	uint32_t pass;
+	// - Impostor.y and Impostor.z of UniformBufferObject
+	float impostorDiameter;
+	float meshDiameter;
 };
 
+// - std140 rounds the block up to a multiple of 16 bytes and the bound range has to cover all of
+//   it, so fields added above need explicit padding members to keep this true
+static_assert(sizeof(CullUniforms) % 16 == 0, "CullUniforms must match the std140 size of CullParams");
+
+// - compute pass group size, matches local_size_x in cs_cull_source
+constexpr GLuint CULL_GROUP_SIZE = 64;
+// - depth pyramid reduction group size, matches local_size_x/y in cs_depth_reduce_source
+constexpr GLuint DEPTH_REDUCE_GROUP_SIZE = 8;
+
 namespace buffer
 {
 	enum type
 	{
 		VERTEX,
 		ELEMENT,
-		TRANSFORM,
+		INSTANCE,
+		// - 0..N-1, drawn through when instances are not culled
+		INSTANCE_ID,
+		// - surviving instance ids written by the cull pass, one bucket of N per level of detail
+		//   and pass
+		VISIBLE,
+		// - one flag per instance, set when the last late pass found it unoccluded
+		VISIBILITY,
+		LOD,
 		MAX
 	};
 }
 
-const char* const vs_source = R"(
-#version 460 core
+// Features the mesh shaders are specialized for, one bit each; every mask is a program variant
+// built with a #define per set bit, so a pass only fetches the attributes it uses.
+namespace mesh_feature
+{
+	constexpr uint32_t COMPACT = 1u << 0;
+	constexpr uint32_t TEXTURE = 1u << 1;
+	constexpr uint32_t VERTEX_COLOR = 1u << 2;
+	// - dithered cross-fade into the impostor
+	constexpr uint32_t IMPOSTOR_FADE = 1u << 3;
+	constexpr uint32_t COUNT = 4;
+
+	// - macro names by bit; VARYINGS is also defined whenever the stages pass anything along
+	constexpr std::array<const char*, COUNT> DEFINES{ "COMPACT", "TEXTURE", "VERTEX_COLOR", "IMPOSTOR_FADE" };
+	constexpr uint32_t VARYINGS = TEXTURE | VERTEX_COLOR | IMPOSTOR_FADE;
+
+	constexpr uint32_t forShading(mesh_shading::type shading)
+	{
+		return shading == mesh_shading::TEXTURE ? TEXTURE : shading == mesh_shading::COLOR ? VERTEX_COLOR : 0;
+	}
+}
+
+// - the impostor atlas always shows the textured mesh, since it is cached for every run; the vertex
+//   format and texture compression it was baked with are part of the cache key
+constexpr uint32_t IMPOSTOR_BAKE_FEATURES = mesh_feature::TEXTURE;
+
+std::string meshDefines(uint32_t features);
+
+// GLSL every shader stage gets after its #version line and #defines, see ShaderBuilder.
+const char* const shader_prelude = R"(
+// Instance in crowd.h: translation and scale, then a unit quaternion
+struct Instance
+{
+    vec4 positionScale;
+    vec4 rotation;
+};
+
+vec3 transformPoint(Instance instance, vec3 p)
+{
+    vec3 q = instance.rotation.xyz;
+    vec3 rotated = p + 2.0 * cross(q, cross(q, p) + instance.rotation.w * p);
+    return rotated * instance.positionScale.w + instance.positionScale.xyz;
+}
+
+// 0 draws the mesh, 1 the impostor, in between the two dissolve into each other; `impostor` is
+// the pixels per unit at distance 1 and the impostor and mesh diameters of the fade, the
+// impostor one 0 without impostors
+float impostorFade(Instance instance, vec4 meshBounds, vec4 cameraPosition, vec3 impostor)
+{
+    if (impostor.y <= 0.0)
+        return 0.0;
+    vec3 center = transformPoint(instance, meshBounds.xyz);
+    float radius = meshBounds.w * instance.positionScale.w;
+    float distance = max(length(center - cameraPosition.xyz) - radius, cameraPosition.w);
+    float diameter = 2.0 * radius * impostor.x / distance;
+    return clamp((impostor.z - diameter) / (impostor.z - impostor.y), 0.0, 1.0);
+}
+
+// 4x4 ordered dither threshold in (0, 1); the mesh keeps the pixels at or above the fade and the
+// impostor the ones below, so the two never overlap or leave a gap
+float dither(vec2 fragCoord)
+{
+    const float bayer[16] = float[](0.0, 8.0, 2.0, 10.0, 12.0, 4.0, 14.0, 6.0, 3.0, 11.0, 1.0, 9.0, 15.0, 7.0, 13.0, 5.0);
+    ivec2 p = ivec2(fragCoord) & 3;
+    return (bayer[p.y * 4 + p.x] + 0.5) / 16.0;
+}
+)";
+
+// Mesh shaders, see mesh_feature.
+const char* const vs_mesh_source = R"(
+#version 450 core
 
 layout(binding = 1) uniform UniformBufferObject {
-    mat4 MVP;
+    mat4 ViewProjection;
+    vec4 CameraPosition;
+    vec4 MeshBounds;
+    vec4 Impostor;
 } ubo;
 
+layout(std430, binding = 2) readonly buffer Instances
+{
+    Instance instance[];
+} instances;
+
+// per-instance attribute so baseInstance can pick a bucket of culled instance ids
+layout(location = 0) in uint instanceId;
+
+#ifdef COMPACT
+// CompactMeshHeader followed by one CompactVertex (3 uints) per vertex
+layout(std430, binding = 0) buffer Mesh
+{
+    vec4 positionMin;
+    vec4 positionScale;
+    vec4 texcoordMinScale;
+    uint vertex[];
+} mesh;
+#else
 struct Vertex
 {
     vec4 position;
@@ -107,118 +349,874 @@ layout(std430, binding = 0) buffer Mesh
 {
     Vertex vertex[];
 } mesh;
+#endif
 
 out gl_PerVertex
 {
     vec4 gl_Position;
 };
 
+#ifdef VARYINGS
 out block
 {
+#ifdef VERTEX_COLOR
     vec4 Color;
+#endif
+#ifdef TEXTURE
     vec2 Texcoord;
+#endif
+#ifdef IMPOSTOR_FADE
+    float Fade;
+#endif
 } Out;
+#endif
 
 void main()
 {
-    gl_Position = ubo.MVP * mesh.vertex[gl_VertexID].position;
+#ifdef COMPACT
+    uint base = 3u * uint(gl_VertexID);
+    vec2 xy = unpackUnorm2x16(mesh.vertex[base + 0u]);
+    vec2 z = unpackUnorm2x16(mesh.vertex[base + 1u]);
+    vec3 position = mesh.positionMin.xyz + vec3(xy, z.x) * mesh.positionScale.xyz;
+#else
+    vec3 position = mesh.vertex[gl_VertexID].position.xyz;
+#endif
+    gl_Position = ubo.ViewProjection * vec4(transformPoint(instances.instance[instanceId], position), 1.0);
+
+#ifdef VERTEX_COLOR
+#ifdef COMPACT
+    // compact vertices carry no color
+    Out.Color = vec4(1.0);
+#else
     Out.Color = mesh.vertex[gl_VertexID].color;
+#endif
+#endif
+
+#ifdef TEXTURE
+#ifdef COMPACT
+    vec2 uv = unpackUnorm2x16(mesh.vertex[base + 2u]);
+    Out.Texcoord = mesh.texcoordMinScale.xy + uv * mesh.texcoordMinScale.zw;
+#else
     Out.Texcoord = mesh.vertex[gl_VertexID].texcoord;
+#endif
+#endif
+
+#ifdef IMPOSTOR_FADE
+    Out.Fade = impostorFade(instances.instance[instanceId], ubo.MeshBounds, ubo.CameraPosition, ubo.Impostor.xyz);
+#endif
 }
 )";
 
-const char* const fs_source = R"(
-#version 460 core
+const char* const fs_mesh_source = R"(
+#version 450 core
 
+#ifdef TEXTURE
 layout(binding = 1) uniform sampler2D tex;
+#endif
 
+#ifdef VARYINGS
 in block
 {
+#ifdef VERTEX_COLOR
     vec4 Color;
+#endif
+#ifdef TEXTURE
     vec2 Texcoord;
+#endif
+#ifdef IMPOSTOR_FADE
+    float Fade;
+#endif
 } In;
+#endif
 
 layout(location = 0) out vec4 color;
 
 void main()
 {
-    color = texture(tex, In.Texcoord);
+#ifdef IMPOSTOR_FADE
+    if (dither(gl_FragCoord.xy) < In.Fade)
+        discard;
+#endif
+    color = vec4(1.0);
+#ifdef VERTEX_COLOR
+    color *= In.Color;
+#endif
+#ifdef TEXTURE
+    color *= texture(tex, In.Texcoord);
+#endif
 }
 )";
 
+const char* const vs_impostor_source = R"(
+#version 450 core
 
-int main()
+layout(binding = 1) uniform UniformBufferObject {
+    mat4 ViewProjection;
+    vec4 CameraPosition;
+    vec4 MeshBounds;
+    vec4 Impostor;
+} ubo;
+
+layout(std430, binding = 2) readonly buffer Instances
 {
-	if (!glfwInit())
-		return -1;
+    Instance instance[];
+} instances;
 
-	glfwSetErrorCallback(error_callback);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
-	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-	glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+layout(location = 0) in uint instanceId;
 
-	GLFWwindow* window = glfwCreateWindow(WIDTH, HEIGHT, "Rabbit", nullptr, nullptr);
-	if (!window)
-	{
-		std::cout << "Failed to create GLFW window\n";
-		glfwTerminate();
-		return -1;
-	}
+// IMPOSTOR_GRID in impostor.h
+const uint GRID = 16u;
+
+// octahedralDecode and octahedralEncode in impostor.cpp
+vec2 signNotZero(vec2 v)
+{
+    return vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
 
-	glfwMakeContextCurrent(window);
+vec3 octahedralDecode(vec2 e)
+{
+    vec3 n = vec3(e.x, 1.0 - abs(e.x) - abs(e.y), e.y);
+    if (n.y < 0.0)
+        n.xz = (1.0 - abs(n.zx)) * signNotZero(n.xz);
+    return normalize(n);
+}
+
+vec2 octahedralEncode(vec3 direction)
+{
+    vec3 n = direction / (abs(direction.x) + abs(direction.y) + abs(direction.z));
+    vec2 e = n.xz;
+    if (n.y < 0.0)
+        e = (1.0 - abs(e.yx)) * signNotZero(e);
+    return e;
+}
+
+out gl_PerVertex
+{
+    vec4 gl_Position;
+};
 
-	glfwSetKeyCallback(window, key_callback);
-	glfwSetMouseButtonCallback(window, mouse_button_callback);
-	glfwSetCursorPosCallback(window, cursor_position_callback);
-	glfwSetScrollCallback(window, scroll_callback);
+out block
+{
+    vec2 Texcoord;
+    // world position on the plane through the bounding sphere's center, and the world vector
+    // from the near to the far side of the sphere along the atlas view
+    vec3 Position;
+    vec3 Depth;
+    float Fade;
+} Out;
+
+void main()
+{
+    // - the atlas view closest to the direction the camera sees the instance from, in mesh space
+    Instance instance = instances.instance[instanceId];
+    vec3 center = transformPoint(instance, ubo.MeshBounds.xyz);
+    vec3 q = -instance.rotation.xyz;
+    vec3 p = ubo.CameraPosition.xyz - center;
+    vec3 toCamera = p + 2.0 * cross(q, cross(q, p) + instance.rotation.w * p);
+    uvec2 cell = min(uvec2((octahedralEncode(normalize(toCamera)) * 0.5 + 0.5) * float(GRID)), uvec2(GRID - 1u));
+    vec3 direction = octahedralDecode((vec2(cell) + 0.5) / float(GRID) * 2.0 - 1.0);
+
+    // - the same basis impostorViewProjection gives the view, the quad's corners are indices 0..3
+    vec3 up = abs(direction.y) > 0.999 ? vec3(0.0, 0.0, 1.0) : vec3(0.0, 1.0, 0.0);
+    vec3 right = normalize(cross(-direction, up));
+    up = cross(right, -direction);
+    vec2 corner = vec2(gl_VertexID == 1 || gl_VertexID == 2 ? 1.0 : -1.0, gl_VertexID >= 2 ? 1.0 : -1.0);
+
+    vec3 position = transformPoint(instance, ubo.MeshBounds.xyz + (right * corner.x + up * corner.y) * ubo.MeshBounds.w);
+    gl_Position = ubo.ViewProjection * vec4(position, 1.0);
+    Out.Texcoord = (vec2(cell) + corner * 0.5 + 0.5) / float(GRID);
+    Out.Position = position;
+    Out.Depth = transformPoint(instance, ubo.MeshBounds.xyz - direction * ubo.MeshBounds.w) -
+        transformPoint(instance, ubo.MeshBounds.xyz + direction * ubo.MeshBounds.w);
+    Out.Fade = impostorFade(instance, ubo.MeshBounds, ubo.CameraPosition, ubo.Impostor.xyz);
+}
+)";
+
+const char* const fs_impostor_source = R"(
+#version 450 core
+
+layout(binding = 1) uniform UniformBufferObject {
+    mat4 ViewProjection;
+    vec4 CameraPosition;
+    vec4 MeshBounds;
+    vec4 Impostor;
+} ubo;
 
-	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+layout(binding = 3) uniform sampler2D impostorColor;
+layout(binding = 4) uniform sampler2D impostorDepth;
+
+in block
+{
+    vec2 Texcoord;
+    vec3 Position;
+    vec3 Depth;
+    float Fade;
+} In;
+
+layout(location = 0) out vec4 color;
+
+void main()
+{
+    vec4 texel = texture(impostorColor, In.Texcoord);
+    if (texel.a < 0.5 || dither(gl_FragCoord.xy) >= In.Fade)
+        discard;
+
+    // - move the fragment to the depth the mesh had in the atlas view
+    float depth = texture(impostorDepth, In.Texcoord).r;
+    vec4 clip = ubo.ViewProjection * vec4(In.Position + In.Depth * (depth - 0.5), 1.0);
+    gl_FragDepth = clip.z / clip.w * 0.5 + 0.5;
+    color = vec4(texel.rgb, 1.0);
+}
+)";
+
+const char* const vs_hud_source = R"(
+#version 450 core
+
+// 2 * overlay scale / framebuffer size; overlay units run right and down from the top left corner
+layout(location = 0) uniform vec2 scale;
+
+layout(location = 0) in vec2 position;
+layout(location = 1) in vec4 color;
+
+out gl_PerVertex
+{
+    vec4 gl_Position;
+};
+
+out block
+{
+    vec4 Color;
+} Out;
+
+void main()
+{
+    gl_Position = vec4(position.x * scale.x - 1.0, 1.0 - position.y * scale.y, 0.0, 1.0);
+    Out.Color = color;
+}
+)";
+
+const char* const fs_hud_source = R"(
+#version 450 core
+
+in block
+{
+    vec4 Color;
+} In;
+
+layout(location = 0) out vec4 color;
+
+void main()
+{
+    color = In.Color;
+}
+)";
+
+const char* const cs_cull_source = R"(
+#version 450 core
+
+layout(local_size_x = 64) in;
+
+// MeshLod in mesh.h
+struct MeshLod
+{
+    uint firstIndex;
+    uint indexCount;
+    float error;
+    uint firstMeshlet;
+    uint meshletCount;
+};
+
+struct DrawCommand
+{
+    uint count;
+    uint instanceCount;
+    uint firstIndex;
+    int baseVertex;
+    uint baseInstance;
+};
+
+const uint PASS_FRUSTUM = 0u;
+const uint PASS_EARLY = 1u;
+const uint PASS_LATE = 2u;
+
+layout(std140, binding = 3) uniform CullParams
+{
+    vec4 planes[5];
+    vec4 cameraPosition;
+    vec4 meshBounds;
+    mat4 view;
+    vec4 projection;
+    float pixelsPerUnit;
+    float maxErrorPixels;
+    int forcedLod;
+    uint lodCount;
+    uint instanceCount;
+    uint pass;
+    float impostorDiameter;
+    float meshDiameter;
+} params;
+
+// farthest depth over each texel's footprint, see cs_depth_reduce_source
+layout(binding = 2) uniform sampler2D depthPyramid;
+
+layout(std430, binding = 2) readonly buffer Instances
+{
+    Instance instance[];
+} instances;
+
+layout(std430, binding = 4) readonly buffer Lods
+{
+    MeshLod lod[];
+} lods;
+
+// one command per level of detail and one for the impostors, instanceCount starts at zero
+layout(std430, binding = 5) buffer Commands
+{
+    DrawCommand command[];
+} commands;
+
+layout(std430, binding = 6) writeonly buffer Visible
+{
+    uint id[];
+} visible;
+
+layout(std430, binding = 7) buffer Visibility
+{
+    uint flag[];
+} visibility;
+
+// occluded instances the late pass kept from being drawn, per command
+layout(std430, binding = 8) buffer Occlusion
+{
+    uint occluded[];
+} occlusion;
+
+// Screen rectangle (min uv, max uv) of a view space sphere entirely in front of the near plane,
+// from 2D Polyhedral Bounds of a Clipped, Perspective-Projected 3D Sphere (Mara, McGuire 2013)
+bool projectSphere(vec3 c, float r, out vec4 rect)
+{
+    c.z = -c.z;
+    if (c.z < r + params.cameraPosition.w)
+        return false;
+
+    vec3 cr = c * r;
+    float czr2 = c.z * c.z - r * r;
+    float vx = sqrt(c.x * c.x + czr2);
+    float minx = (vx * c.x - cr.z) / (vx * c.z + cr.x);
+    float maxx = (vx * c.x + cr.z) / (vx * c.z - cr.x);
+    float vy = sqrt(c.y * c.y + czr2);
+    float miny = (vy * c.y - cr.z) / (vy * c.z + cr.y);
+    float maxy = (vy * c.y + cr.z) / (vy * c.z - cr.y);
+    rect = vec4(minx * params.projection.x, miny * params.projection.y, maxx * params.projection.x, maxy * params.projection.y) * 0.5 + 0.5;
+    return true;
+}
+
+void emit(uint command, uint index)
+{
+    uint slot = atomicAdd(commands.command[command].instanceCount, 1u);
+    visible.id[commands.command[command].baseInstance + slot] = index;
+}
+
+bool occluded(vec3 center, float radius)
+{
+    vec3 c = (params.view * vec4(center, 1.0)).xyz;
+    vec4 rect;
+    if (!projectSphere(c, radius, rect))
+        return false;
+
+    // - the level where the rectangle spans at most 2x2 texels
+    ivec2 size = textureSize(depthPyramid, 0);
+    ivec2 lo = clamp(ivec2(rect.xy * vec2(size)), ivec2(0), size - 1);
+    ivec2 hi = clamp(ivec2(rect.zw * vec2(size)), ivec2(0), size - 1);
+    int span = max(hi.x - lo.x, hi.y - lo.y);
+    int level = min(span > 0 ? findMSB(span) + 1 : 0, textureQueryLevels(depthPyramid) - 1);
+    ivec2 last = max(size >> level, ivec2(1)) - 1;
+    lo = min(lo >> level, last);
+    hi = min(hi >> level, last);
+    float farthest = max(max(texelFetch(depthPyramid, lo, level).r, texelFetch(depthPyramid, ivec2(hi.x, lo.y), level).r),
+        max(texelFetch(depthPyramid, ivec2(lo.x, hi.y), level).r, texelFetch(depthPyramid, hi, level).r));
+
+    // - window depth of the sphere's nearest point; without glClipControl GL maps [-1, 1] to [0, 1]
+    float z = c.z + radius;
+    float depth = (params.projection.z * z + params.projection.w) / -z;
+    return depth * 0.5 + 0.5 > farthest;
+}
+
+void main()
+{
+    uint index = gl_GlobalInvocationID.x;
+    if (index >= params.instanceCount)
+        return;
+
+    Instance instance = instances.instance[index];
+    vec3 center = transformPoint(instance, params.meshBounds.xyz);
+    float radius = params.meshBounds.w * instance.positionScale.w;
+    for (int i = 0; i < 5; ++i)
+    {
+        if (dot(params.planes[i].xyz, center) + params.planes[i].w < -radius)
+        {
+            if (params.pass == PASS_LATE)
+                visibility.flag[index] = 0u;
+            return;
+        }
+    }
+    if (params.pass == PASS_EARLY && visibility.flag[index] == 0u)
+        return;
+
+    uint level = 0u;
+    if (params.forcedLod >= 0)
+    {
+        level = min(uint(params.forcedLod), params.lodCount - 1u);
+    }
+    else
+    {
+        float distance = max(length(center - params.cameraPosition.xyz) - radius, params.cameraPosition.w);
+        float pixelsPerUnit = params.pixelsPerUnit * instance.positionScale.w / distance;
+        for (uint i = 1u; i < params.lodCount; ++i)
+        {
+            if (lods.lod[i].error * pixelsPerUnit > params.maxErrorPixels)
+                break;
+            level = i;
+        }
+    }
+
+    // - the mesh, the impostor or both while they cross-fade
+    float fade = impostorFade(instance, params.meshBounds, params.cameraPosition,
+        vec3(params.pixelsPerUnit, params.impostorDiameter, params.meshDiameter));
+
+    // - the early pass already drew what was visible last frame
+    if (params.pass == PASS_LATE)
+    {
+        bool drawn = visibility.flag[index] != 0u;
+        bool hidden = occluded(center, radius);
+        visibility.flag[index] = hidden ? 0u : 1u;
+        if (hidden && !drawn)
+            atomicAdd(occlusion.occluded[fade < 1.0 ? level : params.lodCount], 1u);
+        if (hidden || drawn)
+            return;
+    }
+
+    if (fade < 1.0)
+        emit(level, index);
+    if (fade > 0.0)
+        emit(params.lodCount, index);
+}
+)";
+
+const char* const cs_depth_reduce_source = R"(
+#version 450 core
+
+layout(local_size_x = 8, local_size_y = 8) in;
+
+// the depth buffer for level 0, the previous pyramid level after that
+layout(binding = 0) uniform sampler2D source;
+layout(binding = 0, r32f) uniform writeonly image2D destination;
+layout(location = 0) uniform int sourceLevel;
+
+void main()
+{
+    ivec2 size = imageSize(destination);
+    ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+    if (any(greaterThanEqual(texel, size)))
+        return;
+
+    // - farthest depth of the 2x2 footprint; the last row and column also take the odd texel left
+    //   at the edge, so texel x of level n covers pixels [x << n, (x + 1) << n) of level 0 and the
+    //   last one everything beyond
+    ivec2 sourceSize = textureSize(source, sourceLevel);
+    ivec2 scale = ivec2(greaterThan(sourceSize, size)) + 1;
+    ivec2 first = texel * scale;
+    ivec2 last = mix(first + scale - 1, sourceSize - 1, equal(texel, size - 1));
+    float depth = 0.0;
+    for (int y = first.y; y <= last.y; ++y)
+    {
+        for (int x = first.x; x <= last.x; ++x)
+            depth = max(depth, texelFetch(source, ivec2(x, y), sourceLevel).r);
+    }
+    imageStore(destination, texel, vec4(depth));
+}
+)";
+
+
+int main(int argc, char* argv[])
+{
+	const Options options = parseOptions(argc, argv);
+	if (options.cullBenchmark)
+		return runCullBenchmark();
+	if (!options.traceFile.empty())
 	{
-		std::cout << "Failed to initialize OpenGL context" << std::endl;
+#if !BUNNY_PROFILE
+		std::cerr << "Profiling zones were compiled out (BUNNY_PROFILE=0), no trace will be written\n";
+#endif
+		setProfiling(true);
+		setProfileThreadName("main");
+	}
+
+	std::vector<CameraKeyframe> cameraScript = defaultCameraScript();
+	if (!options.cameraScript.empty() && !loadCameraScript(options.cameraScript, cameraScript))
+	{
+		std::cout << "Failed to load camera script: " << options.cameraScript << '\n';
 		return -1;
 	}
 
-	if (GLAD_GL_VERSION_4_6) {
-		std::cout << "We support at least OpenGL version 4.6" << std::endl;
+	// - startup phases for the benchmark report, and as zones in the trace
+	BenchmarkReport report;
+	double phaseStart = elapsedSeconds();
+	uint64_t phaseZoneStart = profileNow();
+	const auto endPhase = [&](const char* name) {
+		const double now = elapsedSeconds();
+		report.loadPhases.emplace_back(name, (now - phaseStart) * 1000.0);
+		phaseStart = now;
+		if (profiling())
+			recordProfileZone(name, phaseZoneStart, profileNow());
+		phaseZoneStart = profileNow();
+	};
+
+	// - 4.5 is all the renderer needs, which keeps it running on Mesa's llvmpipe
+	constexpr int GL_MAJOR = 4;
+	constexpr int GL_MINOR = 5;
+	GLFWwindow* window = nullptr;
+	HeadlessContext headless;
+	int width = options.width;
+	int height = options.height;
+	if (options.headless)
+	{
+		PROFILE_ZONE("HeadlessContext::create");
+		if (!headless.create(GL_MAJOR, GL_MINOR))
+		{
+			std::cout << "Failed to create a headless OpenGL context\n";
+			return -1;
+		}
 	}
+	else
+	{
+		{
+			PROFILE_ZONE("glfwInit");
+			if (!glfwInit())
+				return -1;
+		}
 
-	int width, height;
-	glfwGetFramebufferSize(window, &width, &height);
-	glViewport(0, 0, width, height);
+		PROFILE_ZONE("glfwCreateWindow");
+		glfwSetErrorCallback(error_callback);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, GL_MAJOR);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, GL_MINOR);
+		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+		glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
 
-	const auto [program, pipeline] = createShaderProgram({ vs_source, fs_source });
+		window = glfwCreateWindow(width, height, "Rabbit", nullptr, nullptr);
+		if (!window)
+		{
+			std::cout << "Failed to create GLFW window\n";
+			glfwTerminate();
+			return -1;
+		}
+
+		glfwMakeContextCurrent(window);
 
-	loadModel("model/rabbit.obj");
+		glfwSetKeyCallback(window, key_callback);
+		glfwSetMouseButtonCallback(window, mouse_button_callback);
+		glfwSetCursorPosCallback(window, cursor_position_callback);
+		glfwSetScrollCallback(window, scroll_callback);
+	}
 
-	GLint alignment = 0;
-	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
-	GLint blockSize = glm::max(GLint(sizeof(UniformBufferObject)), alignment);
+	const auto loadProc = options.headless ? (GLADloadproc)HeadlessContext::procAddress : (GLADloadproc)glfwGetProcAddress;
+	{
+		PROFILE_ZONE("gladLoadGLLoader");
+		if (!gladLoadGLLoader(loadProc))
+		{
+			std::cout << "Failed to initialize OpenGL context" << std::endl;
+			return -1;
+		}
+	}
+
+	std::cout << "OpenGL " << glGetString(GL_VERSION) << " on " << glGetString(GL_RENDERER) << std::endl;
+
+	if (window)
+		glfwGetFramebufferSize(window, &width, &height);
+	aspectRatio = float(width) / float(height);
+	glViewport(0, 0, width, height);
+	endPhase("context");
+
+	// - every program is submitted here and only checked when first used, so the driver compiles
+	//   them while the model and texture load
+	const bool compact = options.vertexFormat == vertex_format::COMPACT;
+	ProgramCache programCache(options.programCache ? PROGRAM_CACHE_DIRECTORY : "");
+	auto programs = std::make_unique<ShaderBuilder>(&programCache, loadProc, shader_prelude);
+	ShaderVariants meshPrograms(*programs, { { GL_VERTEX_SHADER, vs_mesh_source }, { GL_FRAGMENT_SHADER, fs_mesh_source } }, meshDefines);
+	const uint32_t meshFeatures = (compact ? mesh_feature::COMPACT : 0) | mesh_feature::forShading(options.shading);
+	meshPrograms.prepare(meshFeatures);
+	if (options.impostorSize > 0.0f && (options.crowd > 1 || options.crowdBenchmark))
+		meshPrograms.prepare(meshFeatures | mesh_feature::IMPOSTOR_FADE);
+	const auto cullProgram = programs->add({ { GL_COMPUTE_SHADER, cs_cull_source } });
+	const auto reduceProgram = programs->add({ { GL_COMPUTE_SHADER, cs_depth_reduce_source } });
+	const auto impostorProgram = programs->add({ { GL_VERTEX_SHADER, vs_impostor_source }, { GL_FRAGMENT_SHADER, fs_impostor_source } });
+	const auto hudProgram = programs->add({ { GL_VERTEX_SHADER, vs_hud_source }, { GL_FRAGMENT_SHADER, fs_hud_source } });
+	endPhase("shaders");
+
+	// - the texture decodes on a loader thread while the model loads, and uploads frame by frame
+	const std::string modelFilename = "model/rabbit.obj";
+	const std::string textureFilename = "model/rabbit.jpg";
+	auto textures = std::make_unique<TextureStreamer>(options.textureBudget);
+	const auto modelTexture = textures->load(textureFilename, options.textureCompression, options.model.cache);
+	endPhase("texture");
+
+	const Mesh mesh = loadModel(modelFilename, options.model);
+	if (mesh.lods.empty())
+	{
+		std::cout << "Failed to load model: " << modelFilename << '\n';
+		if (!options.headless)
+			glfwTerminate();
+		return -1;
+	}
+	endPhase("model");
+	programs->poll();
+	const glm::vec4 bounds = boundingSphere(mesh.vertices);
 
 	std::array<GLuint, buffer::MAX> buffers{};
 	glCreateBuffers(buffer::MAX, buffers.data());
-	glNamedBufferStorage(buffers[buffer::VERTEX], vertices.size() * sizeof(Vertex), vertices.data(), 0);
-	glNamedBufferStorage(buffers[buffer::ELEMENT], indices.size() * sizeof(uint32_t), indices.data(), 0);
-	glNamedBufferStorage(buffers[buffer::TRANSFORM], blockSize, nullptr, GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT);
+	if (compact)
+	{
+		const auto compactVertices = buildCompactVertexBuffer(mesh.vertices);
+		glNamedBufferStorage(buffers[buffer::VERTEX], compactVertices.size(), compactVertices.data(), 0);
+	}
+	else
+	{
+		glNamedBufferStorage(buffers[buffer::VERTEX], mesh.vertices.size_bytes(), mesh.vertices.data(), 0);
+	}
+	std::cout << "Vertex buffer: " << mesh.vertices.size() * sizeof(Vertex) / 1048576.0 << " MB full ("
+		<< sizeof(Vertex) << " bytes/vertex), " << mesh.vertices.size() * sizeof(CompactVertex) / 1048576.0 << " MB compact ("
+		<< sizeof(CompactVertex) << " bytes/vertex), using " << (compact ? "compact" : "full") << '\n';
+	// - the impostor quad's corners follow the mesh indices, see vs_impostor_source
+	constexpr uint32_t IMPOSTOR_QUAD[]{ 0, 1, 2, 0, 2, 3 };
+	const auto impostorFirstIndex = static_cast<uint32_t>(mesh.indices.size());
+	glNamedBufferStorage(buffers[buffer::ELEMENT], mesh.indices.size_bytes() + sizeof(IMPOSTOR_QUAD), nullptr, GL_DYNAMIC_STORAGE_BIT);
+	glNamedBufferSubData(buffers[buffer::ELEMENT], 0, mesh.indices.size_bytes(), mesh.indices.data());
+	glNamedBufferSubData(buffers[buffer::ELEMENT], mesh.indices.size_bytes(), sizeof(IMPOSTOR_QUAD), IMPOSTOR_QUAD);
+
+	// - the instance buffer is immutable, so a new crowd size gets a new buffer; the camera backs
+	//   off until the whole crowd is in view
+	const bool occlusion = options.crowdCulling == crowd_culling::OCCLUSION;
+	const size_t cullPasses = occlusion ? 2 : 1;
+	// - GPU culling sorts instances into one draw per level of detail plus one for the impostors
+	const size_t cullDraws = mesh.lods.size() + 1;
+	size_t instanceCount = 0;
+	glm::vec4 drawBounds = bounds;
+	InstanceBounds instanceBounds;
+	const auto setCrowd = [&](size_t count) {
+		PROFILE_ZONE("setCrowd");
+		const auto instances = buildCrowd(count, bounds);
+		std::vector<uint32_t> ids(instances.size());
+		std::iota(ids.begin(), ids.end(), 0u);
+		glDeleteBuffers(4, &buffers[buffer::INSTANCE]);
+		glCreateBuffers(4, &buffers[buffer::INSTANCE]);
+		glNamedBufferStorage(buffers[buffer::INSTANCE], instances.size() * sizeof(Instance), instances.data(), 0);
+		glNamedBufferStorage(buffers[buffer::INSTANCE_ID], ids.size() * sizeof(uint32_t), ids.data(), 0);
+		glNamedBufferStorage(buffers[buffer::VISIBLE], cullPasses * cullDraws * ids.size() * sizeof(uint32_t), nullptr, 0);
+		glNamedBufferStorage(buffers[buffer::VISIBILITY], ids.size() * sizeof(uint32_t), nullptr, 0);
+		glClearNamedBufferData(buffers[buffer::VISIBILITY], GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+		instanceCount = instances.size();
+		instanceBounds = buildInstanceBounds(instances, bounds);
+		drawBounds = crowdBounds(instances, bounds);
+		if (instanceCount > 1)
+			frameCrowd(drawBounds);
+	};
+	const bool benchmark = options.crowdBenchmark;
+	setCrowd(benchmark ? CROWD_BENCHMARK_COUNTS[0] : options.crowd);
+
+	// - per frame: the transform block, per cull pass a cull block, its draws and occlusion counts,
+	//   one draw per meshlet of the largest level, the visible instance ids of CPU culling, the
+	//   overlay's vertices, plus room for the alignment padding of each allocation
+	size_t maxMeshlets = 1;
+	for (const auto& level : mesh.lods)
+		maxMeshlets = std::max<size_t>(maxMeshlets, level.meshletCount);
+	std::vector<DrawElementsIndirectCommand> draws;
+	draws.reserve(std::max(maxMeshlets, cullDraws));
+	const size_t maxInstances = benchmark ? *std::max_element(std::begin(CROWD_BENCHMARK_COUNTS), std::end(CROWD_BENCHMARK_COUNTS)) : options.crowd;
+	auto uploads = std::make_unique<UploadRing>(sizeof(UniformBufferObject) + sizeof(CullUniforms) +
+		std::max(maxMeshlets, cullDraws) * sizeof(DrawElementsIndirectCommand) +
+		(options.crowdCulling == crowd_culling::CPU ? maxInstances * sizeof(uint32_t) : 0) + 3 * 256 +
+		(occlusion ? sizeof(CullUniforms) + cullDraws * (sizeof(DrawElementsIndirectCommand) + sizeof(uint32_t)) + 3 * 256 : 0) +
+		(options.hud ? Hud::FRAME_BYTES + 256 : 0));
+	glNamedBufferStorage(buffers[buffer::LOD], mesh.lods.size_bytes(), mesh.lods.data(), 0);
+
+	// - GPU culling results are read back once the ring hands the same region out again, by which
+	//   time its fence has passed; the GPU timers run in step with the ring, so the pass times
+	//   read back in the same frame belong to the same frame as the counts
+	std::array<UploadRing::Allocation, FRAMES_IN_FLIGHT> cullCommands{};
+	std::array<UploadRing::Allocation, FRAMES_IN_FLIGHT> lateCommands{};
+	std::array<UploadRing::Allocation, FRAMES_IN_FLIGHT> occlusionCounts{};
+	std::array<bool, FRAMES_IN_FLIGHT> cullPending{};
+	auto gpuTimers = std::make_unique<GpuTimers>();
+	size_t gpuVisible = 0;
+	size_t gpuImpostors = 0;
+	// - triangles of the instances both GPU culling passes let through, impostor quads included
+	size_t gpuTriangles = 0;
+	double gpuCullMs = 0.0;
+	size_t lateVisible = 0;
+	size_t occludedInstances = 0;
+	double pyramidMs = 0.0;
+	double savedMs = 0.0;
+
+	// - occlusion culling draws into its own framebuffer so the depth can be reduced into the
+	//   pyramid, and copies the color to the window at the end of the frame. Headless runs have
+	//   no window to draw to and frame dumps read the color back, so they draw there as well
+	std::array<GLuint, 3> sceneTextures{};
+	GLuint sceneFramebuffer = 0;
+	if (occlusion || options.headless || !options.dumpPrefix.empty())
+	{
+		glCreateTextures(GL_TEXTURE_2D, 2, sceneTextures.data());
+		glTextureStorage2D(sceneTextures[0], 1, GL_RGBA8, width, height);
+		glTextureStorage2D(sceneTextures[1], 1, GL_DEPTH_COMPONENT32F, width, height);
+		if (occlusion)
+			sceneTextures[2] = createDepthPyramid(width, height);
+		glCreateFramebuffers(1, &sceneFramebuffer);
+		glNamedFramebufferTexture(sceneFramebuffer, GL_COLOR_ATTACHMENT0, sceneTextures[0], 0);
+		glNamedFramebufferTexture(sceneFramebuffer, GL_DEPTH_ATTACHMENT, sceneTextures[1], 0);
+		if (glCheckNamedFramebufferStatus(sceneFramebuffer, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+			std::cout << "Incomplete scene framebuffer\n";
+	}
+	const auto cullKernel = bestCullKernel();
+	std::vector<uint32_t> visibleInstances;
+	InstanceCullStats cpuCullStats;
 	
 	GLuint vao = 0;
 	glCreateVertexArrays(1, &vao);
 	glVertexArrayElementBuffer(vao, buffers[buffer::ELEMENT]);
+	glEnableVertexArrayAttrib(vao, 0);
+	glVertexArrayAttribIFormat(vao, 0, 1, GL_UNSIGNED_INT, 0);
+	glVertexArrayAttribBinding(vao, 0, 0);
+	glVertexArrayBindingDivisor(vao, 0, 1);
 	
-	GLuint tex = loadTexture("model/rabbit.jpg");
+	endPhase("buffers");
+	programs->poll();
 	
 	glEnable(GL_DEPTH_TEST);
 	glDepthFunc(GL_LEQUAL);
+
+	// - impostor atlas of the finest level, baked through the mesh pipeline once per model and texture
+	std::array<GLuint, 2> impostorTextures{};
+	// - the atlas is only baked when a GPU culled crowd can draw it
+	const bool impostors = options.impostorSize > 0.0f && (options.crowd > 1 || benchmark) &&
+		(options.crowdCulling == crowd_culling::GPU || occlusion);
+	if (impostors)
+	{
+		const auto start = elapsedSeconds();
+		const auto cacheName = modelFilename + ".impostor";
+		FileStamp modelStamp;
+		FileStamp textureStamp;
+		const bool useCache = options.model.cache && fileStamp(modelFilename, modelStamp) && fileStamp(textureFilename, textureStamp);
+		const uint32_t bakeFlags = (meshFeatures & mesh_feature::COMPACT ? impostor_bake::COMPACT_VERTICES : 0) |
+			(textures->compressed(modelTexture) ? impostor_bake::COMPRESSED_TEXTURE : 0);
+		ImpostorAtlas atlas;
+		const bool cached = useCache && readImpostorCache(cacheName, modelStamp, textureStamp, bakeFlags, atlas);
+		if (!cached)
+		{
+			textures->finish(modelTexture);
+			atlas = renderImpostorAtlas(meshPrograms.pipeline((meshFeatures & mesh_feature::COMPACT) | IMPOSTOR_BAKE_FEATURES), vao,
+				buffers[buffer::VERTEX], textures->texture(modelTexture), mesh, bounds);
+			glViewport(0, 0, width, height);
+			if (useCache && !writeImpostorCache(cacheName, modelStamp, textureStamp, bakeFlags, atlas))
+				std::cerr << "Failed to write impostor cache: " << cacheName << '\n';
+		}
+		impostorTextures = createImpostorTextures(atlas);
+		std::cout << (cached ? "Loaded " : "Baked ") << atlas.grid * atlas.grid << " impostor views (" << atlas.size() << "x"
+			<< atlas.size() << " atlas) in " << (elapsedSeconds() - start) * 1000.0 << " ms\n";
+		endPhase("impostors");
+	}
+
+	// - only the interactive window streams the texture in; headless, dumped and benchmarked runs
+	//   render every frame with all of it so their output does not depend on the loader's timing
+	if (options.headless || !options.dumpPrefix.empty() || options.benchmarkFrames > 0 || benchmark)
+	{
+		textures->finish(modelTexture);
+		endPhase("texture upload");
+	}
 	
+	const float pixelsAtUnitDistance = float(height) / (2.0f * glm::tan(glm::radians(FIELD_OF_VIEW) * 0.5f));
+
 	// time management
-	float currentFrame = (float)glfwGetTime(), deltaTime = 0.0f, lastFrame = 0.0f;
+	float currentFrame = (float)elapsedSeconds(), deltaTime = 0.0f, lastFrame = currentFrame;
 	float time = 0.0f;
 	GLuint  fps = 0;
+	size_t lod = 0;
+	CullStats cullStats;
+
+	// - overlay: the text is rebuilt every frame from the counts below and the latest timings;
+	//   the frame rate and memory use are sampled once a second along with the title
+	auto hud = options.hud ? std::make_unique<Hud>(programs->program(hudProgram), programs->pipeline(hudProgram)) : nullptr;
+	std::string hudText;
+	double hudCpuMs = 0.0;
+	double cpuMs = 0.0;
+	GLuint shownFps = 0;
+	size_t residentBytes = currentResidentBytes();
+
+	// - programs not used during startup finish on the first frame
+	programs->poll();
+	const auto& programStats = programs->stats();
+	std::cout << "Shader programs: " << programStats.cached << " loaded from cache, " << programStats.compiled << " compiled, "
+		<< programStats.failed << " failed, " << programs->pending() << " still building";
+	if (programs->compilerThreads() > 0)
+		std::cout << " on " << programs->compilerThreads() << " compiler threads";
+	std::cout << "; " << programStats.blockedMs << " ms spent waiting\n";
+
+	// - benchmark: frames to settle after a crowd change, then frames to time
+	constexpr int BENCHMARK_WARMUP_FRAMES = 10;
+	constexpr int BENCHMARK_FRAMES = 100;
+	size_t benchmarkStep = 0;
+	int benchmarkFrame = 0;
+	double benchmarkStart = 0.0;
+	if (benchmark)
+	{
+		if (window)
+			glfwSwapInterval(0);
+		std::cout << "Crowd benchmark (" << BENCHMARK_FRAMES << " frames each, GPU finished every frame)\n"
+			<< "instances\tms/frame\tFPS\tMtriangles/s\n";
+	}
 	
-	while (!glfwWindowShouldClose(window))
+	// - scripted benchmark: the camera holds the first keyframe through the warm-up, then plays the
+	//   script over the timed frames. GPU times reach the samples as the timers read them back
+	const bool scripted = options.benchmarkFrames > 0 && !benchmark;
+	const float scriptZoom = zoom;
+	if (scripted)
+	{
+		if (window)
+			glfwSwapInterval(0);
+		report.frames.reserve(options.benchmarkFrames);
+	}
+	const auto recordGpuFrame = [&](const GpuFrame& gpu) {
+		if (!scripted || gpu.frame < options.warmupFrames || gpu.frame - options.warmupFrames >= report.frames.size())
+			return;
+		auto& sample = report.frames[gpu.frame - options.warmupFrames];
+		sample.gpuMs = gpu.ms;
+		for (const auto& pass : gpu.passes)
+			sample.gpuPasses.emplace_back(pass.name, pass.ms);
+	};
+
+	// - headless runs stop after their frames since nothing can close them
+	const size_t frameLimit = scripted ? options.warmupFrames + options.benchmarkFrames :
+		options.frames ? options.frames : options.headless && !benchmark ? 1 : 0;
+	size_t frameCount = 0;
+	bool quit = false;
+	const double runStart = elapsedSeconds();
+	while (!quit && !(window && glfwWindowShouldClose(window)))
 	{
+		PROFILE_ZONE("frame");
+		const bool gpuCrowd = (options.crowdCulling == crowd_culling::GPU || occlusion) && instanceCount > 1;
+		const bool cpuCrowd = options.crowdCulling == crowd_culling::CPU && instanceCount > 1;
+		const double frameStart = elapsedSeconds();
+		const bool timed = scripted && frameCount >= options.warmupFrames;
+		if (scripted)
+		{
+			PROFILE_ZONE("camera script");
+			const size_t step = timed ? frameCount - options.warmupFrames : 0;
+			const auto key = sampleCameraScript(cameraScript, float(step) / float(std::max<size_t>(options.benchmarkFrames - 1, 1)));
+			zoom = scriptZoom * key.zoom;
+			rotation = key.rotation;
+			farPlane = glm::max(farPlane, zoom + 2.0f * drawBounds.w);
+		}
+
 		// - calculate time spent on last frame
-		currentFrame = (float)glfwGetTime();
+		currentFrame = (float)elapsedSeconds();
 		deltaTime = currentFrame - lastFrame;
 		lastFrame = currentFrame;
 		// - periodcally display the FPS the game is running in
@@ -226,45 +1224,557 @@ int main()
 		++fps;
 		if (time >= 1.0f)
 		{
+			PROFILE_ZONE("title");
 			time -= 1.0f;
-			glfwSetWindowTitle(window, std::string("FPS: " + std::to_string(fps)).c_str());
+			// - GPU time of the latest frame read back, pass by pass
+			std::string gpuPasses;
+			for (const auto& pass : gpuTimers->latest().passes)
+				gpuPasses += (gpuPasses.empty() ? "" : ", ") + std::string(pass.name) + " " + std::to_string(pass.ms);
+			const auto title = std::string("FPS: " + std::to_string(fps) + " (" + std::to_string(1000.0f / fps) +
+				" ms, " + (compact ? "compact" : "full") + " vertices, LOD " + std::to_string(lod) + ": " +
+				std::to_string(mesh.lods[lod].indexCount / 3) + " triangles" +
+				(instanceCount > 1 && !gpuCrowd && !cpuCrowd ? " x " + std::to_string(instanceCount) + " instances" : "") +
+				(cpuCrowd ? ", CPU culling " + std::to_string(cpuCullStats.visible) + "/" + std::to_string(instanceCount) +
+					" instances visible in " + std::to_string(cpuCullStats.milliseconds) + " ms on " +
+					std::to_string(cpuCullStats.threads) + " threads" : "") +
+				(gpuCrowd && !occlusion ? ", GPU culling " + std::to_string(gpuVisible) + "/" + std::to_string(instanceCount) +
+					" instances visible in " + std::to_string(gpuCullMs) + " ms" : "") +
+				(gpuCrowd && impostors ? ", " + std::to_string(gpuImpostors) + " impostors" : "") +
+				(gpuCrowd && occlusion ? ", occlusion culling " + std::to_string(gpuVisible) + "+" + std::to_string(lateVisible) +
+					"/" + std::to_string(instanceCount) + " instances drawn, " + std::to_string(occludedInstances) + " occluded, cull " +
+					std::to_string(gpuCullMs) + " ms, pyramid " + std::to_string(pyramidMs) + " ms, ~" +
+					std::to_string(savedMs) + " ms saved" : "") +
+				(options.meshletCulling && instanceCount == 1 ? ", meshlets " + std::to_string(cullStats.meshlets - cullStats.frustumCulled - cullStats.backfaceCulled) +
+					"/" + std::to_string(cullStats.meshlets) + ", " + std::to_string(cullStats.triangles) + " triangles drawn" : "") + ")" +
+				" GPU " + std::to_string(gpuTimers->latest().ms) + " ms (" + gpuPasses + ")");
+			if (window)
+				glfwSetWindowTitle(window, title.c_str());
+			else
+				std::cout << title << '\n';
+			shownFps = fps;
 			fps = 0;
+			residentBytes = currentResidentBytes();
 		}
 
+		const glm::mat4 mvp = camera(zoom, rotation);
+		const glm::mat4 view = cameraView(zoom, rotation);
+		uploads->beginFrame();
+		textures->update();
+		const GpuFrame* gpuFrame = gpuTimers->beginFrame(frameCount);
+		if (gpuFrame)
 		{
-			auto Pointer = static_cast<UniformBufferObject*>(glMapNamedBufferRange(buffers[buffer::TRANSFORM], 0,
-				blockSize, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
-			Pointer->MVP = camera(zoom, rotation);
-			glUnmapNamedBuffer(buffers[buffer::TRANSFORM]);
+			recordGpuFrame(*gpuFrame);
+			if (hud)
+				hud->gpuFrame(gpuFrame->frame, gpuFrame->ms);
 		}
+		if (const auto frame = uploads->frameIndex(); cullPending[frame])
+		{
+			PROFILE_ZONE("cull readback");
 
+			// - instances cross-fading to their impostor count once as a mesh and once as an impostor
+			const auto commands = static_cast<const DrawElementsIndirectCommand*>(cullCommands[frame].data);
+			const auto commandTriangles = [&](size_t i) {
+				return size_t(i < mesh.lods.size() ? mesh.lods[i].indexCount : std::size(IMPOSTOR_QUAD)) / 3;
+			};
+			gpuVisible = 0;
+			gpuTriangles = 0;
+			for (size_t i = 0; i < cullDraws; ++i)
+			{
+				gpuVisible += i < mesh.lods.size() ? commands[i].instanceCount : 0;
+				gpuTriangles += commandTriangles(i) * commands[i].instanceCount;
+			}
+			gpuImpostors = commands[mesh.lods.size()].instanceCount;
+			if (gpuFrame)
+				gpuCullMs = gpuFrame->passMs("cull") + gpuFrame->passMs("late cull");
+			if (occlusion)
+			{
+				// - the time saved is estimated from the draw cost per triangle, less the pyramid
+				//   and the second cull pass that occlusion culling adds
+				const auto late = static_cast<const DrawElementsIndirectCommand*>(lateCommands[frame].data);
+				const auto occluded = static_cast<const uint32_t*>(occlusionCounts[frame].data);
+				lateVisible = 0;
+				occludedInstances = 0;
+				double occludedTriangles = 0.0;
+				gpuImpostors += late[mesh.lods.size()].instanceCount;
+				for (size_t i = 0; i < cullDraws; ++i)
+				{
+					lateVisible += i < mesh.lods.size() ? late[i].instanceCount : 0;
+					occludedInstances += occluded[i];
+					gpuTriangles += commandTriangles(i) * late[i].instanceCount;
+					occludedTriangles += double(commandTriangles(i)) * occluded[i];
+				}
+				const double drawnTriangles = double(gpuTriangles);
+				if (gpuFrame)
+				{
+					const double lateCullMs = gpuFrame->passMs("late cull");
+					const double drawMs = gpuFrame->passMs("draw") + gpuFrame->passMs("late draw");
+					pyramidMs = gpuFrame->passMs("pyramid");
+					savedMs = (drawnTriangles > 0.0 ? drawMs * occludedTriangles / drawnTriangles : 0.0) - pyramidMs - lateCullMs;
+				}
+			}
+			cullPending[frame] = false;
+		}
+		UploadRing::Allocation transform;
+		if (auto Pointer = uploads->allocate<UniformBufferObject>(transform))
+		{
+			PROFILE_ZONE("uniforms");
+			// - only GPU culling sorts instances into impostors, every other path draws meshes alone
+			const float impostorSize = gpuCrowd && impostors ? options.impostorSize : 0.0f;
+			Pointer->ViewProjection = mvp;
+			Pointer->CameraPosition = glm::vec4(glm::vec3(glm::inverse(view)[3]), NEAR_PLANE);
+			Pointer->MeshBounds = bounds;
+			Pointer->Impostor = glm::vec4(pixelsAtUnitDistance, impostorSize, impostorSize * IMPOSTOR_FADE_RANGE, 0.0f);
+		}
+		const GLuint meshPipeline = meshPrograms.pipeline(meshFeatures | (gpuCrowd && impostors ? mesh_feature::IMPOSTOR_FADE : 0));
+
+		// - level of detail from how many pixels an object space unit covers at the bounding sphere
+		if (options.forcedLod >= 0)
+		{
+			lod = std::min(size_t(options.forcedLod), mesh.lods.size() - 1);
+		}
+		else
+		{
+			const float depth = -(view * glm::vec4(glm::vec3(drawBounds), 1.0f)).z;
+			const float distance = glm::max(depth - drawBounds.w, NEAR_PLANE);
+			lod = selectLod(mesh.lods, pixelsAtUnitDistance / distance, options.lodErrorPixels);
+		}
+
+		glBindFramebuffer(GL_FRAMEBUFFER, sceneFramebuffer);
+		gpuTimers->pass("clear");
 		glClearBufferfv(GL_COLOR, 0, &glm::vec4(0.26f, 0.33f, 0.46f, 1.0f)[0]);
 		glClearBufferfv(GL_DEPTH, 0, &glm::vec4(1.0f)[0]);
 		
-		glBindProgramPipeline(pipeline);
+		glBindProgramPipeline(meshPipeline);
 		glBindVertexArray(vao);
-		glBindTextureUnit(1, tex);
-		glBindBufferBase(GL_UNIFORM_BUFFER, 1, buffers[buffer::TRANSFORM]);
+		glBindTextureUnit(1, textures->texture(modelTexture));
+		uploads->bindRange(GL_UNIFORM_BUFFER, 1, transform);
 		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, buffers[buffer::VERTEX]);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, buffers[buffer::INSTANCE]);
+		glVertexArrayVertexBuffer(vao, 0, buffers[buffer::INSTANCE_ID], 0, sizeof(uint32_t));
+
+		// - what the frame draws, for the overlay; GPU culling's counts are read back frames later
+		const auto& level = mesh.lods[lod];
+		size_t frameTriangles = 0;
+		size_t frameInstances = 0;
+		size_t drawCalls = 0;
+		size_t drawCommands = 0;
+		if (!gpuCrowd)
+			gpuTimers->pass("draw");
+		if (gpuCrowd)
+		{
+			PROFILE_ZONE("submit GPU culled crowd");
+			// - one command per level of detail and pass; the cull passes fill in the instance counts
+			const auto frame = uploads->frameIndex();
+			const glm::mat4 projection = mvp * glm::inverse(view);
+			const auto frustum = extractFrustum(mvp);
+			CullUniforms cull{};
+			std::copy(std::begin(frustum.planes), std::end(frustum.planes), cull.planes);
+			cull.cameraPosition = glm::vec4(glm::vec3(glm::inverse(view)[3]), NEAR_PLANE);
+			cull.meshBounds = bounds;
+			cull.view = view;
+			cull.projection = glm::vec4(projection[0][0], projection[1][1], projection[2][2], projection[3][2]);
+			cull.pixelsPerUnit = pixelsAtUnitDistance;
+			cull.maxErrorPixels = options.lodErrorPixels;
+			cull.forcedLod = options.forcedLod;
+			cull.lodCount = static_cast<uint32_t>(mesh.lods.size());
+			cull.instanceCount = static_cast<uint32_t>(instanceCount);
+			cull.impostorDiameter = impostors ? options.impostorSize : 0.0f;
+			cull.meshDiameter = cull.impostorDiameter * IMPOSTOR_FADE_RANGE;
+
+			const auto cullPass = [&](cull_pass::type pass, UploadRing::Allocation& indirect) {
+				UploadRing::Allocation cullUniforms;
+				auto params = uploads->allocate<CullUniforms>(cullUniforms);
+				auto commands = uploads->allocate<DrawElementsIndirectCommand>(indirect, cullDraws);
+				if (!params || !commands)
+					return false;
+				*params = cull;
+				params->pass = pass;
+				const size_t firstBucket = pass == cull_pass::LATE ? cullDraws : 0;
+				for (size_t i = 0; i < mesh.lods.size(); ++i)
+				{
+					commands[i] = { mesh.lods[i].indexCount, 0, mesh.lods[i].firstIndex, 0,
+						static_cast<uint32_t>((firstBucket + i) * instanceCount) };
+				}
+				commands[mesh.lods.size()] = { static_cast<uint32_t>(std::size(IMPOSTOR_QUAD)), 0, impostorFirstIndex, 0,
+					static_cast<uint32_t>((firstBucket + mesh.lods.size()) * instanceCount) };
+				glBindProgramPipeline(programs->pipeline(cullProgram));
+				uploads->bindRange(GL_UNIFORM_BUFFER, 3, cullUniforms);
+				uploads->bindRange(GL_SHADER_STORAGE_BUFFER, 5, indirect);
+				glDispatchCompute(static_cast<GLuint>((instanceCount + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE), 1, 1);
+				glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_CLIENT_MAPPED_BUFFER_BARRIER_BIT |
+					GL_SHADER_STORAGE_BARRIER_BIT);
+				return true;
+			};
+			const auto drawCulled = [&](const UploadRing::Allocation& indirect) {
+				glBindProgramPipeline(meshPipeline);
+				glVertexArrayVertexBuffer(vao, 0, buffers[buffer::VISIBLE], 0, sizeof(uint32_t));
+				glBindBuffer(GL_DRAW_INDIRECT_BUFFER, uploads->buffer());
+				glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, reinterpret_cast<const void*>(indirect.offset),
+					static_cast<GLsizei>(mesh.lods.size()), 0);
+				if (impostors)
+				{
+					glBindProgramPipeline(programs->pipeline(impostorProgram));
+					glBindTextureUnit(3, impostorTextures[0]);
+					glBindTextureUnit(4, impostorTextures[1]);
+					glDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+						reinterpret_cast<const void*>(indirect.offset + mesh.lods.size() * sizeof(DrawElementsIndirectCommand)));
+				}
+			};
 
-		glDrawElementsInstanced(GL_TRIANGLES, static_cast<GLsizei>(indices.size()), GL_UNSIGNED_INT, nullptr, 1);
-		
-		glfwSwapBuffers(window);
-		glfwPollEvents();
+			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, buffers[buffer::LOD]);
+			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, buffers[buffer::VISIBLE]);
+			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 7, buffers[buffer::VISIBILITY]);
+			gpuTimers->pass("cull");
+			bool culled = cullPass(occlusion ? cull_pass::EARLY : cull_pass::FRUSTUM, cullCommands[frame]);
+			if (culled)
+			{
+				gpuTimers->pass("draw");
+				drawCulled(cullCommands[frame]);
+			}
+			if (culled && occlusion)
+			{
+				auto occluded = uploads->allocate<uint32_t>(occlusionCounts[frame], cullDraws);
+				culled = occluded != nullptr;
+				if (culled)
+				{
+					std::fill_n(occluded, cullDraws, 0u);
+					uploads->bindRange(GL_SHADER_STORAGE_BUFFER, 8, occlusionCounts[frame]);
+					gpuTimers->pass("pyramid");
+					buildDepthPyramid(programs->program(reduceProgram), programs->pipeline(reduceProgram), sceneTextures[1], sceneTextures[2], width, height);
+					gpuTimers->pass("late cull");
+					glBindTextureUnit(2, sceneTextures[2]);
+					culled = cullPass(cull_pass::LATE, lateCommands[frame]);
+				}
+				if (culled)
+				{
+					gpuTimers->pass("late draw");
+					drawCulled(lateCommands[frame]);
+				}
+			}
+			cullPending[frame] = culled;
+			frameTriangles = gpuTriangles;
+			frameInstances = gpuVisible + lateVisible + gpuImpostors;
+			drawCalls = cullPasses * (impostors ? 2 : 1);
+			drawCommands = cullPasses * (impostors ? cullDraws : mesh.lods.size());
+		}
+		else if (cpuCrowd)
+		{
+			PROFILE_ZONE("submit CPU culled crowd");
+			cullInstances(extractFrustum(mvp), instanceBounds, defaultThreadPool(), visibleInstances, cullKernel, &cpuCullStats);
+			UploadRing::Allocation ids;
+			if (auto visible = uploads->allocate<uint32_t>(ids, visibleInstances.size()))
+			{
+				std::memcpy(visible, visibleInstances.data(), visibleInstances.size() * sizeof(uint32_t));
+				glVertexArrayVertexBuffer(vao, 0, uploads->buffer(), ids.offset, sizeof(uint32_t));
+				glDrawElementsInstanced(GL_TRIANGLES, static_cast<GLsizei>(level.indexCount), GL_UNSIGNED_INT,
+					reinterpret_cast<const void*>(size_t(level.firstIndex) * sizeof(uint32_t)), static_cast<GLsizei>(visibleInstances.size()));
+				frameTriangles = size_t(level.indexCount / 3) * visibleInstances.size();
+				frameInstances = visibleInstances.size();
+				drawCalls = drawCommands = 1;
+			}
+		}
+		else if (options.meshletCulling && instanceCount == 1)
+		{
+			PROFILE_ZONE("submit meshlets");
+			// - the single instance is the identity, so the eye in mesh space is the inverse view's translation
+			const glm::vec3 eye(glm::inverse(view)[3]);
+			draws.clear();
+			cullMeshlets(mesh.meshlets.subspan(level.firstMeshlet, level.meshletCount), extractFrustum(mvp), eye, draws, &cullStats);
+			UploadRing::Allocation indirect;
+			if (auto commands = uploads->allocate<DrawElementsIndirectCommand>(indirect, draws.size()))
+			{
+				std::memcpy(commands, draws.data(), draws.size() * sizeof(DrawElementsIndirectCommand));
+				glBindBuffer(GL_DRAW_INDIRECT_BUFFER, uploads->buffer());
+				glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, reinterpret_cast<const void*>(indirect.offset),
+					static_cast<GLsizei>(draws.size()), 0);
+				frameTriangles = cullStats.triangles;
+				frameInstances = 1;
+				drawCalls = 1;
+				drawCommands = draws.size();
+			}
+		}
+		else
+		{
+			PROFILE_ZONE("submit instances");
+			glDrawElementsInstanced(GL_TRIANGLES, static_cast<GLsizei>(level.indexCount), GL_UNSIGNED_INT,
+				reinterpret_cast<const void*>(size_t(level.firstIndex) * sizeof(uint32_t)), static_cast<GLsizei>(instanceCount));
+			frameTriangles = size_t(level.indexCount / 3) * instanceCount;
+			frameInstances = instanceCount;
+			drawCalls = drawCommands = 1;
+		}
+
+		if (hud)
+		{
+			PROFILE_ZONE("hud");
+			gpuTimers->pass("hud");
+			const double hudStart = elapsedSeconds();
+			const GpuFrame& gpu = gpuTimers->latest();
+			hudText.clear();
+			const auto hudLine = [&](const char* format, auto... args) {
+				char line[160];
+				std::snprintf(line, sizeof(line), format, args...);
+				hudText += line;
+				hudText += '\n';
+			};
+			hudLine("FPS %u (%.2f ms)   CPU %.2f ms   GPU %.2f ms", shownFps, shownFps ? 1000.0 / shownFps : 0.0, cpuMs, gpu.ms);
+			hudLine("LOD %zu   %zu triangles   %zu instances   %zu draws (%zu commands)", lod, frameTriangles, frameInstances,
+				drawCalls, drawCommands);
+			if (cpuCrowd)
+				hudLine("CPU culling %zu/%zu visible in %.3f ms on %u threads", cpuCullStats.visible, instanceCount,
+					cpuCullStats.milliseconds, cpuCullStats.threads);
+			else if (gpuCrowd && occlusion)
+				hudLine("Occlusion culling %zu+%zu/%zu drawn, %zu impostors, %zu occluded, ~%.2f ms saved", gpuVisible, lateVisible,
+					instanceCount, gpuImpostors, occludedInstances, savedMs);
+			else if (gpuCrowd)
+				hudLine("GPU culling %zu/%zu visible, %zu impostors", gpuVisible, instanceCount, gpuImpostors);
+			else if (options.meshletCulling && instanceCount == 1)
+				hudLine("Meshlets %zu/%zu drawn", cullStats.meshlets - cullStats.frustumCulled - cullStats.backfaceCulled, cullStats.meshlets);
+			hudLine("Memory %.1f MB resident (peak %.1f MB), upload ring peak %.1f of %.1f KB/frame", residentBytes / 1048576.0,
+				peakResidentBytes() / 1048576.0, uploads->stats().peakFrameBytes / 1024.0, uploads->frameBytes() / 1024.0);
+			for (const auto& pass : gpu.passes)
+				hudLine("  %-10s %7.3f ms", pass.name, pass.ms);
+			hudLine("HUD %.3f ms CPU", hudCpuMs);
+			if (!hud->draw(*uploads, hudText, width, height))
+				std::cerr << "Upload ring full, overlay skipped\n";
+			hudCpuMs = (elapsedSeconds() - hudStart) * 1000.0;
+		}
+		if (window && sceneFramebuffer)
+		{
+			gpuTimers->pass("blit");
+			glBlitNamedFramebuffer(sceneFramebuffer, 0, 0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+		}
+		gpuTimers->endFrame();
+		uploads->endFrame();
+		const double submitted = elapsedSeconds();
+		cpuMs = (submitted - frameStart) * 1000.0;
+		if (hud)
+			hud->cpuFrame(frameCount, cpuMs);
+		if (!options.dumpPrefix.empty())
+		{
+			PROFILE_ZONE("dump frame");
+			auto number = std::to_string(frameCount);
+			number.insert(0, number.size() < 5 ? 5 - number.size() : 0, '0');
+			const auto filename = options.dumpPrefix + number + ".png";
+			if (!writeFrame(sceneTextures[0], width, height, filename))
+				std::cerr << "Failed to write frame: " << filename << '\n';
+		}
+		if (window)
+		{
+			{
+				PROFILE_ZONE("glfwSwapBuffers");
+				glfwSwapBuffers(window);
+			}
+			PROFILE_ZONE("glfwPollEvents");
+			glfwPollEvents();
+		}
+		if (timed)
+		{
+			FrameSample sample;
+			sample.cpuMs = cpuMs;
+			sample.frameMs = (elapsedSeconds() - frameStart) * 1000.0;
+			report.frames.push_back(sample);
+		}
+		if (++frameCount == frameLimit)
+			quit = true;
+
+		if (benchmark)
+		{
+			{
+				PROFILE_ZONE("glFinish");
+				glFinish();
+			}
+			if (++benchmarkFrame == BENCHMARK_WARMUP_FRAMES)
+				benchmarkStart = elapsedSeconds();
+			if (benchmarkFrame == BENCHMARK_WARMUP_FRAMES + BENCHMARK_FRAMES)
+			{
+				const double ms = (elapsedSeconds() - benchmarkStart) * 1000.0 / BENCHMARK_FRAMES;
+				std::cout << instanceCount << '\t' << ms << '\t' << 1000.0 / ms << '\t'
+					<< double(mesh.lods[lod].indexCount / 3) * double(instanceCount) / (ms * 1000.0) << '\n';
+				benchmarkFrame = 0;
+				if (++benchmarkStep == std::size(CROWD_BENCHMARK_COUNTS))
+					quit = true;
+				else
+					setCrowd(CROWD_BENCHMARK_COUNTS[benchmarkStep]);
+			}
+		}
+	}
+
+	if (options.headless)
+	{
+		glFinish();
+		const double ms = (elapsedSeconds() - runStart) * 1000.0;
+		std::cout << "Rendered " << frameCount << " frames of " << width << "x" << height << " headless in " << ms
+			<< " ms (" << ms / double(std::max<size_t>(frameCount, 1)) << " ms/frame)\n";
+	}
+	if (textures->pending() > 0)
+		std::cout << textures->pending() << " textures were still loading or streaming in at exit\n";
+
+	for (const auto& gpu : gpuTimers->flush())
+		recordGpuFrame(gpu);
+	if (gpuTimers->dropped())
+		std::cout << "GPU timers: " << gpuTimers->dropped() << " frames dropped with their queries still pending\n";
+	gpuTimers.reset();
+	hud.reset();
+
+	if (scripted)
+	{
+		static const char* const cullingNames[crowd_culling::MAX]{ "none", "cpu", "gpu", "occlusion" };
+		static const char* const shadingNames[mesh_shading::MAX]{ "texture", "color", "flat" };
+		report.config = {
+			{ "renderer", reinterpret_cast<const char*>(glGetString(GL_RENDERER)) },
+			{ "size", std::to_string(width) + "x" + std::to_string(height) },
+			{ "headless", options.headless ? "true" : "false" },
+			{ "vertex_format", compact ? "compact" : "full" },
+			{ "shading", shadingNames[options.shading] },
+			{ "texture_compression", options.textureCompression ? "true" : "false" },
+			{ "texture_budget_kib", std::to_string(options.textureBudget / 1024) },
+			{ "crowd", std::to_string(instanceCount) },
+			{ "crowd_culling", cullingNames[options.crowdCulling] },
+			{ "meshlet_culling", options.meshletCulling ? "true" : "false" },
+			{ "lod", options.forcedLod >= 0 ? std::to_string(options.forcedLod) : "auto" },
+			{ "lod_error", std::to_string(options.lodErrorPixels) },
+			{ "impostor_size", std::to_string(impostors ? options.impostorSize : 0.0f) },
+			{ "program_cache", programCache.enabled() ? std::to_string(programCache.stats().hits) + " hits, " +
+				std::to_string(programCache.stats().misses) + " misses" : "off" },
+			{ "shader_wait_ms", std::to_string(programStats.blockedMs) },
+			{ "camera_script", options.cameraScript.empty() ? "default" : options.cameraScript },
+			{ "warmup_frames", std::to_string(options.warmupFrames) },
+			{ "frames", std::to_string(report.frames.size()) },
+		};
+		printBenchmarkReport(std::cout, report);
+		if (!options.reportFile.empty() && !writeBenchmarkReport(options.reportFile, report))
+			std::cerr << "Failed to write benchmark report: " << options.reportFile << '\n';
 	}
 
-	glDeleteProgramPipelines(1, &pipeline);
-	glDeleteProgram(program);
+	if (!options.traceFile.empty())
+	{
+		setProfiling(false);
+		if (writeChromeTrace(options.traceFile))
+			std::cout << "Wrote trace: " << options.traceFile << '\n';
+		else
+			std::cerr << "Failed to write trace: " << options.traceFile << '\n';
+		if (const size_t dropped = droppedProfileZones())
+			std::cout << "Profiler: " << dropped << " zones dropped with their thread's buffer full\n";
+	}
+
+	const auto& uploadStats = uploads->stats();
+	std::cout << "Upload ring: " << FRAMES_IN_FLIGHT << " x " << uploads->frameBytes() << " bytes, peak "
+		<< uploadStats.peakFrameBytes << " bytes per frame, " << uploadStats.stalls << " fence stalls ("
+		<< uploadStats.stallMs << " ms)\n";
+	uploads.reset();
+
+	glDeleteTextures(GLsizei(impostorTextures.size()), impostorTextures.data());
+	glDeleteFramebuffers(1, &sceneFramebuffer);
+	glDeleteTextures(GLsizei(sceneTextures.size()), sceneTextures.data());
+	programs.reset();
 	glDeleteVertexArrays(1, &vao);
 	glDeleteBuffers(buffer::MAX, buffers.data());
-	glDeleteTextures(1, &tex);
+	textures.reset();
 
-	glfwDestroyWindow(window);
-	glfwTerminate();
+	if (window)
+	{
+		glfwDestroyWindow(window);
+		glfwTerminate();
+	}
 
 	return 0;
 }
 
+Options parseOptions(int argc, char* argv[])
+{
+	Options options;
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string_view arg = argv[i];
+		if (arg == "--obj-loader=parallel")
+			options.model.loader = obj_loader::PARALLEL;
+		else if (arg == "--obj-loader=streaming")
+			options.model.loader = obj_loader::STREAMING;
+		else if (arg == "--obj-loader=tinyobj")
+			options.model.loader = obj_loader::TINYOBJ;
+		else if (arg == "--vertex-format=full")
+			options.vertexFormat = vertex_format::FULL;
+		else if (arg == "--vertex-format=compact")
+			options.vertexFormat = vertex_format::COMPACT;
+		else if (arg == "--shading=texture")
+			options.shading = mesh_shading::TEXTURE;
+		else if (arg == "--shading=color")
+			options.shading = mesh_shading::COLOR;
+		else if (arg == "--shading=flat")
+			options.shading = mesh_shading::FLAT;
+		else if (arg == "--no-mesh-cache")
+			options.model.cache = false;
+		else if (arg == "--no-program-cache")
+			options.programCache = false;
+		else if (arg == "--no-texture-compression")
+			options.textureCompression = false;
+		else if (arg.starts_with("--texture-budget="))
+			options.textureBudget = std::strtoull(arg.substr(17).data(), nullptr, 10) * 1024;
+		else if (arg == "--no-vertex-cache-opt")
+			options.model.optimizeVertexCache = false;
+		else if (arg == "--vertex-order=input")
+			options.model.vertexOrder = vertex_order::INPUT;
+		else if (arg == "--vertex-order=fetch")
+			options.model.vertexOrder = vertex_order::FETCH;
+		else if (arg == "--vertex-order=spatial")
+			options.model.vertexOrder = vertex_order::SPATIAL;
+		else if (arg.starts_with("--fetch-line-size="))
+			options.model.fetchLineSize = std::max(1, std::atoi(arg.substr(18).data()));
+		else if (arg.starts_with("--crowd="))
+			options.crowd = std::max<size_t>(1, std::strtoull(arg.substr(8).data(), nullptr, 10));
+		else if (arg == "--crowd-benchmark")
+			options.crowdBenchmark = true;
+		else if (arg == "--crowd-culling=none")
+			options.crowdCulling = crowd_culling::NONE;
+		else if (arg == "--crowd-culling=cpu")
+			options.crowdCulling = crowd_culling::CPU;
+		else if (arg == "--crowd-culling=gpu")
+			options.crowdCulling = crowd_culling::GPU;
+		else if (arg == "--crowd-culling=occlusion")
+			options.crowdCulling = crowd_culling::OCCLUSION;
+		else if (arg == "--cull-benchmark")
+			options.cullBenchmark = true;
+		else if (arg.starts_with("--impostor-size="))
+			options.impostorSize = std::max(0.0f, float(std::atof(arg.substr(16).data())));
+		else if (arg == "--headless")
+			options.headless = true;
+		else if (arg.starts_with("--size="))
+		{
+			const auto size = arg.substr(7);
+			options.width = std::max(1, std::atoi(size.data()));
+			const auto x = size.find('x');
+			options.height = x == std::string_view::npos ? options.width : std::max(1, std::atoi(size.substr(x + 1).data()));
+		}
+		else if (arg.starts_with("--frames="))
+			options.frames = std::strtoull(arg.substr(9).data(), nullptr, 10);
+		else if (arg.starts_with("--dump-frames="))
+			options.dumpPrefix = arg.substr(14);
+		else if (arg.starts_with("--benchmark="))
+			options.benchmarkFrames = std::strtoull(arg.substr(12).data(), nullptr, 10);
+		else if (arg.starts_with("--warmup="))
+			options.warmupFrames = std::strtoull(arg.substr(9).data(), nullptr, 10);
+		else if (arg.starts_with("--camera-script="))
+			options.cameraScript = arg.substr(16);
+		else if (arg.starts_with("--report="))
+			options.reportFile = arg.substr(9);
+		else if (arg.starts_with("--trace="))
+			options.traceFile = arg.substr(8);
+		else if (arg == "--no-hud")
+			options.hud = false;
+		else if (arg == "--no-meshlet-culling")
+			options.meshletCulling = false;
+		else if (arg == "--no-lods")
+			options.model.generateLods = false;
+		else if (arg.starts_with("--lod-error="))
+			options.lodErrorPixels = float(std::atof(arg.substr(12).data()));
+		else if (arg.starts_with("--lod="))
+			options.forcedLod = std::max(0, std::atoi(arg.substr(6).data()));
+		else
+			std::cerr << "Unknown option: " << arg << '\n';
+	}
+	return options;
+}
+
 void error_callback(int error, const char* description)
 {
 	std::cerr << "Error (" << error << "): " << description << "\n";
@@ -316,212 +1826,238 @@ void scroll_callback(GLFWwindow* window, double x, double y)
 		zoom = 0;
 }
 
-void loadModel(const std::string& filename)
+std::string meshDefines(uint32_t features)
 {
-	tinyobj::attrib_t attrib;
-	std::vector<tinyobj::shape_t> shapes;
-	std::vector<tinyobj::material_t> materials;
-	std::string warn;
-	std::string err;
-
-	bool ret = tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, filename.c_str(), "");
-
-	if (!warn.empty()) {
-		std::cout << "WARN: " << warn << std::endl;
-	}
-
-	if (!err.empty()) {
-		std::cerr << err << std::endl;
-	}
-
-	if (!ret) {
-		std::cerr << "Failed to load: " << filename << std::endl;
+	std::string defines;
+	for (uint32_t bit = 0; bit < mesh_feature::COUNT; ++bit)
+	{
+		if (features & (1u << bit))
+			defines += std::string("#define ") + mesh_feature::DEFINES[bit] + '\n';
 	}
+	if (features & mesh_feature::VARYINGS)
+		defines += "#define VARYINGS\n";
+	return defines;
+}
 
-	std::unordered_map<Vertex, uint32_t> uniqueVertices{};
-
-	for (const auto& shape : shapes) {
-		for (const auto& index : shape.mesh.indices) {
-			Vertex vertex{};
-
-			vertex.position = {
-				attrib.vertices[3 * index.vertex_index + 0],
-				attrib.vertices[3 * index.vertex_index + 1],
-				attrib.vertices[3 * index.vertex_index + 2],
-				1.0f
-			};
-
-			vertex.texcoord = {
-				attrib.texcoords[2 * index.texcoord_index + 0],
-				attrib.texcoords[2 * index.texcoord_index + 1]
-			};
-
-			vertex.color = { 1.0f, 1.0f, 1.0f, 1.0f };
-
-			if (uniqueVertices.count(vertex) == 0) {
-				uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
-				vertices.push_back(vertex);
-			}
+glm::mat4 camera(float zoom, const glm::vec2& rotate)
+{
+	glm::mat4 Projection = glm::perspective(glm::radians(FIELD_OF_VIEW), aspectRatio, NEAR_PLANE, farPlane);
+	glm::mat4 View = cameraView(zoom, rotate);
+	glm::mat4 Model = glm::mat4(1.0f);
 
-			indices.push_back(uniqueVertices[vertex]);
-		}
-	}
+	return Projection * View * Model;
 }
 
-GLuint createTexture2D(GLenum internalformat,
-	GLsizei width,
-	GLsizei height,
-	GLenum format,
-	void* data /*= nullptr*/,
-	GLenum minFilter /*= GL_LINEAR*/,
-	GLenum magFilter /*= GL_LINEAR*/,
-	GLenum wrapMode /*= GL_REPEAT*/)
+// Single channel float texture with the full mip chain of a width x height depth buffer.
+GLuint createDepthPyramid(GLsizei width, GLsizei height)
 {
 	GLuint textureId = 0;
 	glCreateTextures(GL_TEXTURE_2D, 1, &textureId);
-	glTextureStorage2D(textureId, 1, internalformat, width, height);
-
-	// set texture filtering parameters
-	glTextureParameteri(textureId, GL_TEXTURE_MIN_FILTER, minFilter);
-	glTextureParameteri(textureId, GL_TEXTURE_MAG_FILTER, magFilter);
-
-	// set the texture wrapping parameters
-	glTextureParameteri(textureId, GL_TEXTURE_WRAP_S, wrapMode);
-	glTextureParameteri(textureId, GL_TEXTURE_WRAP_T, wrapMode);
-
-	if (data)
-	{
-		glTextureSubImage2D(textureId, 0, 0, 0, width, height, format, GL_UNSIGNED_BYTE, data);
-	}
-
-	glGenerateTextureMipmap(textureId);
-
+	glTextureStorage2D(textureId, GLsizei(std::bit_width(unsigned(std::max(width, height)))), GL_R32F, width, height);
+	glTextureParameteri(textureId, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	glTextureParameteri(textureId, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTextureParameteri(textureId, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTextureParameteri(textureId, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 	return textureId;
 }
 
-GLuint loadTexture(std::string_view filename, stb_comp_t comp /*= STBI_rgb_alpha*/)
+// Reduces `depth` into every level of `pyramid`, one dispatch per level, each texel keeping the
+// farthest depth it covers.
+void buildDepthPyramid(GLuint program, GLuint pipeline, GLuint depth, GLuint pyramid, GLsizei width, GLsizei height)
 {
-	stbi_set_flip_vertically_on_load(true);
-	int w, h, c;
-	const auto data = stbi_load(filename.data(), &w, &h, &c, comp);
-	if (!data)
+	glBindProgramPipeline(pipeline);
+	const int levels = std::bit_width(unsigned(std::max(width, height)));
+	for (int level = 0; level < levels; ++level)
 	{
-		std::cout << "Failed to load texture: " << std::string(filename) << '\n';
+		const GLuint levelWidth = std::max(1, width >> level);
+		const GLuint levelHeight = std::max(1, height >> level);
+		glBindTextureUnit(0, level == 0 ? depth : pyramid);
+		glProgramUniform1i(program, 0, std::max(level - 1, 0));
+		glBindImageTexture(0, pyramid, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+		glDispatchCompute((levelWidth + DEPTH_REDUCE_GROUP_SIZE - 1) / DEPTH_REDUCE_GROUP_SIZE,
+			(levelHeight + DEPTH_REDUCE_GROUP_SIZE - 1) / DEPTH_REDUCE_GROUP_SIZE, 1);
+		glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
 	}
-	
-	auto const [in, ex] = [comp]() {
-		switch (comp)
-		{
-		case STBI_rgb_alpha:    return std::make_pair(GL_RGBA8, GL_RGBA);
-		case STBI_rgb:            return std::make_pair(GL_RGB8, GL_RGB);
-		case STBI_grey:            return std::make_pair(GL_R8, GL_RED);
-		case STBI_grey_alpha:    return std::make_pair(GL_RG8, GL_RG);
-		default: std::cerr << "Invalid format\n";
-			return std::make_pair(GL_RGBA8, GL_RGBA);
-		}
-	}();
-
-	const auto name = createTexture2D(in, w, h, ex, data);
-
-	stbi_image_free(data);
-
-	return name;
 }
 
-GLuint createShader(std::string_view source, GLenum shaderType)
+// Renders the finest level of `mesh` through the mesh pipeline into an octahedral atlas, one
+// viewport per view, and reads back color and depth.
+ImpostorAtlas renderImpostorAtlas(GLuint pipeline, GLuint vao, GLuint vertexBuffer, GLuint texture, const Mesh& mesh,
+	const glm::vec4& bounds)
 {
-	const auto csrc = source.data();
-
-	GLuint shader = glCreateShader(shaderType);
-	glShaderSource(shader, 1, &csrc, nullptr);
-	glCompileShader(shader);
-	checkShader(shader);
-
-	return shader;
-}
-
-std::tuple<GLuint, GLuint> createShaderProgram(std::array<std::string_view, 2> const& source)
-{
-	const auto vs = createShader(source[0].data(), GL_VERTEX_SHADER);
-	const auto fs = createShader(source[1].data(), GL_FRAGMENT_SHADER);
-	static const std::array<GLuint, 2>& shaders{ vs, fs };
-
-	GLuint program = glCreateProgram();
-	glProgramParameteri(program, GL_PROGRAM_SEPARABLE, GL_TRUE);
-
-	for (const auto& shader : shaders)
+	PROFILE_ZONE("renderImpostorAtlas");
+	ImpostorAtlas atlas;
+	const auto size = static_cast<GLsizei>(atlas.size());
+	const auto cellSize = static_cast<GLsizei>(atlas.cellSize);
+
+	std::array<GLuint, 2> textures{};
+	glCreateTextures(GL_TEXTURE_2D, 2, textures.data());
+	glTextureStorage2D(textures[0], 1, GL_RGBA8, size, size);
+	glTextureStorage2D(textures[1], 1, GL_DEPTH_COMPONENT32F, size, size);
+	GLuint framebuffer = 0;
+	glCreateFramebuffers(1, &framebuffer);
+	glNamedFramebufferTexture(framebuffer, GL_COLOR_ATTACHMENT0, textures[0], 0);
+	glNamedFramebufferTexture(framebuffer, GL_DEPTH_ATTACHMENT, textures[1], 0);
+
+	// - a single identity instance; the uniform block leaves the impostor cross-fade off
+	const Instance identity{ glm::vec4(0.0f, 0.0f, 0.0f, 1.0f), glm::vec4(0.0f, 0.0f, 0.0f, 1.0f) };
+	const uint32_t instanceId = 0;
+	std::array<GLuint, 3> buffers{};
+	glCreateBuffers(3, buffers.data());
+	glNamedBufferStorage(buffers[0], sizeof(identity), &identity, 0);
+	glNamedBufferStorage(buffers[1], sizeof(instanceId), &instanceId, 0);
+	glNamedBufferStorage(buffers[2], sizeof(UniformBufferObject), nullptr, GL_DYNAMIC_STORAGE_BIT);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glClearBufferfv(GL_COLOR, 0, &glm::vec4(0.0f)[0]);
+	glClearBufferfv(GL_DEPTH, 0, &glm::vec4(1.0f)[0]);
+	glBindProgramPipeline(pipeline);
+	glBindVertexArray(vao);
+	glVertexArrayVertexBuffer(vao, 0, buffers[1], 0, sizeof(uint32_t));
+	glBindTextureUnit(1, texture);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, vertexBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, buffers[0]);
+	glBindBufferBase(GL_UNIFORM_BUFFER, 1, buffers[2]);
+	const auto& level = mesh.lods[0];
+	for (uint32_t y = 0; y < atlas.grid; ++y)
 	{
-		glAttachShader(program, shader);
+		for (uint32_t x = 0; x < atlas.grid; ++x)
+		{
+			UniformBufferObject ubo{};
+			ubo.ViewProjection = impostorViewProjection(x, y, atlas.grid, bounds);
+			glNamedBufferSubData(buffers[2], 0, sizeof(ubo), &ubo);
+			glViewport(GLint(x) * cellSize, GLint(y) * cellSize, cellSize, cellSize);
+			glDrawElementsInstanced(GL_TRIANGLES, static_cast<GLsizei>(level.indexCount), GL_UNSIGNED_INT,
+				reinterpret_cast<const void*>(size_t(level.firstIndex) * sizeof(uint32_t)), 1);
+		}
 	}
 
-	glLinkProgram(program);
-	checkProgram(program);
+	const size_t texels = size_t(size) * size;
+	atlas.color.resize(texels);
+	atlas.depth.resize(texels);
+	glGetTextureImage(textures[0], 0, GL_RGBA, GL_UNSIGNED_BYTE, GLsizei(texels * sizeof(uint32_t)), atlas.color.data());
+	glGetTextureImage(textures[1], 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_SHORT, GLsizei(texels * sizeof(uint16_t)), atlas.depth.data());
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glDeleteBuffers(GLsizei(buffers.size()), buffers.data());
+	glDeleteFramebuffers(1, &framebuffer);
+	glDeleteTextures(GLsizei(textures.size()), textures.data());
+	return atlas;
+}
 
-	for (const auto& shader : shaders)
+// Color (mipmapped within each view) and depth textures of an impostor atlas.
+std::array<GLuint, 2> createImpostorTextures(const ImpostorAtlas& atlas)
+{
+	const auto size = static_cast<GLsizei>(atlas.size());
+	std::array<GLuint, 2> textures{};
+	glCreateTextures(GL_TEXTURE_2D, 2, textures.data());
+
+	// - the mip chain stops where a view shrinks to one texel so views never bleed into each other
+	glTextureStorage2D(textures[0], GLsizei(std::bit_width(atlas.cellSize)), GL_RGBA8, size, size);
+	glTextureSubImage2D(textures[0], 0, 0, 0, size, size, GL_RGBA, GL_UNSIGNED_BYTE, atlas.color.data());
+	glGenerateTextureMipmap(textures[0]);
+	glTextureParameteri(textures[0], GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTextureParameteri(textures[0], GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	glTextureStorage2D(textures[1], 1, GL_R16, size, size);
+	glTextureSubImage2D(textures[1], 0, 0, 0, size, size, GL_RED, GL_UNSIGNED_SHORT, atlas.depth.data());
+	glTextureParameteri(textures[1], GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTextureParameteri(textures[1], GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+	for (const auto texture : textures)
 	{
-		glDetachShader(program, shader);
-		glDeleteShader(shader);
+		glTextureParameteri(texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTextureParameteri(texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 	}
-
-	GLuint pipeline = 0;
-	glCreateProgramPipelines(1, &pipeline);
-	glUseProgramStages(pipeline, GL_VERTEX_SHADER_BIT | GL_FRAGMENT_SHADER_BIT, program);
-
-	return std::make_tuple(program, pipeline);
+	return textures;
 }
 
-void checkShader(GLuint shader)
+// Seconds since the first call. Stands in for glfwGetTime, which needs GLFW initialized and
+// headless runs on EGL never do.
+double elapsedSeconds()
 {
-	GLint isCompiled = GL_FALSE;
-	glGetShaderiv(shader, GL_COMPILE_STATUS, &isCompiled);
-
-	GLint maxLength{};
-	glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &maxLength);
-
-	if (maxLength > 0
-#ifdef NDEBUG
-		&& isCompiled == GL_FALSE
-#endif // NDEBUG
-		)
-	{
-		std::vector<char> buffer(maxLength);
-		glGetShaderInfoLog(shader, maxLength, nullptr, buffer.data());
-		glDeleteShader(shader);
+	static const auto start = std::chrono::steady_clock::now();
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
 
-		std::cout << "Error compiled:\n" << buffer.data() << '\n';
-	}
+// Writes the level 0 color of `texture` to a PNG, top row first.
+bool writeFrame(GLuint texture, int width, int height, const std::string& filename)
+{
+	PROFILE_ZONE("writeFrame");
+	std::vector<uint8_t> pixels(size_t(width) * height * 3);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glGetTextureImage(texture, 0, GL_RGB, GL_UNSIGNED_BYTE, GLsizei(pixels.size()), pixels.data());
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	stbi_flip_vertically_on_write(1);
+	return stbi_write_png(filename.c_str(), width, height, 3, pixels.data(), width * 3) != 0;
 }
 
-void checkProgram(GLuint program)
+// Backs the camera off until a crowd with bounding sphere `bounds` is in view, tilted down onto it.
+void frameCrowd(const glm::vec4& bounds)
 {
-	GLint isLinked = GL_FALSE;
-	glGetProgramiv(program, GL_LINK_STATUS, &isLinked);
+	zoom = glm::max(zoom, bounds.w / glm::sin(glm::radians(FIELD_OF_VIEW) * 0.5f));
+	farPlane = glm::max(farPlane, zoom + 2.0f * bounds.w);
+	rotation.y = glm::max(rotation.y, 30.0f);
+}
 
-	GLint maxLength{};
-	glGetProgramiv(program, GL_INFO_LOG_LENGTH, &maxLength);
+int runCullBenchmark()
+{
+	constexpr size_t INSTANCES = 1000000;
+	constexpr int RUNS = 20;
+	static const char* const kernelNames[cull_kernel::MAX]{ "scalar", "sse", "avx2" };
+
+	// - a unit sphere mesh in the crowd layout and camera the renderer would use
+	const glm::vec4 meshBounds(0.0f, 0.0f, 0.0f, 1.0f);
+	const auto instances = buildCrowd(INSTANCES, meshBounds);
+	const auto bounds = buildInstanceBounds(instances, meshBounds);
+	frameCrowd(crowdBounds(instances, meshBounds));
+	const auto frustum = extractFrustum(camera(zoom, rotation));
+
+	// - the single threaded row runs the kernel over every instance on this thread; a pool always
+	//   has a worker, and parallelFor uses the calling thread on top of them
+	std::vector<uint32_t> visible;
+	const auto cullSerial = [&](cull_kernel::type kernel, InstanceCullStats& stats) {
+		const auto start = std::chrono::steady_clock::now();
+		visible.resize(bounds.size());
+		visible.resize(cullSpheres(frustum, bounds, 0, bounds.size(), visible.data(), kernel));
+		stats.instances = bounds.size();
+		stats.visible = visible.size();
+		stats.threads = 1;
+		stats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	};
 
-	if (maxLength > 0
-#ifdef NDEBUG
-		&& isLinked == GL_FALSE
-#endif // NDEBUG
-		)
+	std::cout << "Instance culling benchmark, " << INSTANCES << " instances, best of " << RUNS << " runs\n"
+		<< "kernel\tthreads\tvisible\tms\tinstances/ms/thread\n";
+	for (int k = 0; k < cull_kernel::MAX; ++k)
 	{
-		std::vector<char> buffer(maxLength);
-		glGetProgramInfoLog(program, maxLength, nullptr, buffer.data());
-		glDeleteProgram(program);
-
-		std::cout << "Error linking:\n" << buffer.data() << '\n';
+		const auto kernel = static_cast<cull_kernel::type>(k);
+		if (kernel > bestCullKernel())
+			continue;
+		for (const bool threaded : { false, true })
+		{
+			InstanceCullStats best;
+			best.milliseconds = std::numeric_limits<double>::max();
+			for (int run = 0; run < RUNS; ++run)
+			{
+				InstanceCullStats stats;
+				if (threaded)
+					cullInstances(frustum, bounds, defaultThreadPool(), visible, kernel, &stats);
+				else
+					cullSerial(kernel, stats);
+				if (stats.milliseconds < best.milliseconds)
+					best = stats;
+			}
+			std::cout << kernelNames[kernel] << '\t' << best.threads << '\t' << best.visible << '\t' << best.milliseconds
+				<< '\t' << double(best.instances) / best.milliseconds / best.threads << '\n';
+		}
 	}
+	return 0;
 }
 
-glm::mat4 camera(float zoom, const glm::vec2& rotate)
+glm::mat4 cameraView(float zoom, const glm::vec2& rotate)
 {
-	auto aspectRatio = static_cast<float>(WIDTH) / static_cast<float>(HEIGHT);
-	glm::mat4 Projection = glm::perspective(glm::radians(45.0f), aspectRatio, 0.1f, 100.0f);
 	glm::mat4 View = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -zoom));
 	View = glm::rotate(View, glm::radians(rotate.y), glm::vec3(1.0f, 0.0f, 0.0f));
 	View = glm::rotate(View, glm::radians(rotate.x), glm::vec3(0.0f, 1.0f, 0.0f));
-	glm::mat4 Model = glm::mat4(1.0f);
-
-	return Projection * View * Model;
+	return View;
 }
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+
+// Read-only memory mapping of a whole file. The mapping is released on destruction.
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	MappedFile(MappedFile&& other) noexcept;
+	MappedFile& operator=(MappedFile&& other) noexcept;
+
+	bool open(const std::string& filename);
+	void close();
+
+	const std::byte* data() const { return data_; }
+	size_t size() const { return size_; }
+	bool valid() const { return data_ != nullptr; }
+
+private:
+	const std::byte* data_ = nullptr;
+	size_t size_ = 0;
+#ifdef _WIN32
+	void* file_ = nullptr;
+	void* mapping_ = nullptr;
+#endif
+};
+
+// Size and modification time of a file, used to detect stale derived files.
+struct FileStamp
+{
+	uint64_t size = 0;
+	int64_t time = 0;
+	bool operator==(const FileStamp& other) const {
+		return size == other.size && time == other.time;
+	}
+};
+
+bool fileStamp(const std::string& filename, FileStamp& stamp);
+
+// Writes `parts` back to back to `filename`, replacing it. The data goes to a temporary file that
+// is then renamed, so a crash never leaves a truncated file behind.
+bool writeFileReplacing(const std::string& filename, std::span<const std::span<const std::byte>> parts);
@@ -0,0 +1,630 @@
+#include "mesh.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <utility>
+
+#include <tiny_obj_loader.h>
+
+#include "corner_map.h"
+#include "mesh_optimizer.h"
+#include "obj_parser.h"
+#include "process_stats.h"
+#include "profile.h"
+#include "thread_pool.h"
+
+namespace
+{
+	namespace section
+	{
+		enum type : uint32_t
+		{
+			VERTEX,
+			INDEX,
+			LOD,
+			MESHLET,
+			MAX
+		};
+	}
+
+	constexpr uint32_t MESH_CACHE_MAGIC = 0x4d594e42; // "BNYM"
+	constexpr uint32_t MESH_CACHE_VERSION = 5;
+	// - sections start on a cache line so the mapped arrays can be handed to GL as they are
+	constexpr uint64_t MESH_CACHE_ALIGNMENT = 64;
+
+	namespace cache_flag
+	{
+		enum type : uint32_t
+		{
+			VERTEX_CACHE_OPTIMIZED = 1 << 0,
+			VERTEX_ORDER_FETCH = 1 << 1,
+			VERTEX_ORDER_SPATIAL = 1 << 2,
+			LOD_CHAIN = 1 << 3
+		};
+	}
+
+	struct MeshCacheHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t vertexSize;
+		uint32_t indexSize;
+		// - processing steps baked into the cooked data, see cache_flag
+		uint32_t flags;
+		uint32_t reserved;
+		uint64_t sourceSize;
+		int64_t sourceTime;
+		// - time the text path took when this cache was cooked, kept for the startup report
+		double sourceLoadMs;
+		struct
+		{
+			uint64_t offset;
+			uint64_t size;
+		} sections[section::MAX];
+	};
+
+	uint64_t alignUp(uint64_t value, uint64_t alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	double millisecondsSince(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	std::string cacheFilename(const std::string& filename)
+	{
+		return filename + ".mesh";
+	}
+
+	uint32_t cacheFlags(const ModelOptions& options)
+	{
+		uint32_t flags = 0;
+		if (options.optimizeVertexCache)
+			flags |= cache_flag::VERTEX_CACHE_OPTIMIZED;
+		if (options.vertexOrder == vertex_order::FETCH)
+			flags |= cache_flag::VERTEX_ORDER_FETCH;
+		if (options.vertexOrder == vertex_order::SPATIAL)
+			flags |= cache_flag::VERTEX_ORDER_SPATIAL;
+		if (options.generateLods)
+			flags |= cache_flag::LOD_CHAIN;
+		return flags;
+	}
+
+	bool readMeshCache(const std::string& filename, const FileStamp& stamp, uint32_t flags, Mesh& mesh, double& sourceLoadMs)
+	{
+		PROFILE_ZONE("readMeshCache");
+		MappedFile file;
+		if (!file.open(filename) || file.size() < sizeof(MeshCacheHeader))
+			return false;
+
+		MeshCacheHeader header{};
+		std::memcpy(&header, file.data(), sizeof(header));
+		if (header.magic != MESH_CACHE_MAGIC || header.version != MESH_CACHE_VERSION ||
+			header.vertexSize != sizeof(Vertex) || header.indexSize != sizeof(uint32_t) || header.flags != flags ||
+			header.sourceSize != stamp.size || header.sourceTime != stamp.time)
+			return false;
+
+		for (const auto& s : header.sections)
+		{
+			if (s.offset % MESH_CACHE_ALIGNMENT != 0 || s.offset + s.size > file.size())
+				return false;
+		}
+
+		const auto& vs = header.sections[section::VERTEX];
+		const auto& is = header.sections[section::INDEX];
+		const auto& ls = header.sections[section::LOD];
+		const auto& ms = header.sections[section::MESHLET];
+		mesh.vertices = { reinterpret_cast<const Vertex*>(file.data() + vs.offset), vs.size / sizeof(Vertex) };
+		mesh.indices = { reinterpret_cast<const uint32_t*>(file.data() + is.offset), is.size / sizeof(uint32_t) };
+		mesh.lods = { reinterpret_cast<const MeshLod*>(file.data() + ls.offset), ls.size / sizeof(MeshLod) };
+		mesh.meshlets = { reinterpret_cast<const Meshlet*>(file.data() + ms.offset), ms.size / sizeof(Meshlet) };
+		if (mesh.lods.empty())
+			return false;
+		for (const auto& lod : mesh.lods)
+		{
+			if (uint64_t(lod.firstIndex) + lod.indexCount > mesh.indices.size() ||
+				uint64_t(lod.firstMeshlet) + lod.meshletCount > mesh.meshlets.size())
+				return false;
+		}
+		for (const auto& meshlet : mesh.meshlets)
+		{
+			if (uint64_t(meshlet.firstIndex) + meshlet.indexCount > mesh.indices.size())
+				return false;
+		}
+		// - vertex pulling and the meshlet and LOD code index the vertices with these unchecked
+		if (!mesh.indices.empty() && std::ranges::max(mesh.indices) >= mesh.vertices.size())
+			return false;
+		mesh.file = std::move(file);
+		sourceLoadMs = header.sourceLoadMs;
+		return true;
+	}
+
+	bool writeMeshCache(const std::string& filename, const FileStamp& stamp, uint32_t flags, const MeshData& mesh,
+		double sourceLoadMs)
+	{
+		PROFILE_ZONE("writeMeshCache");
+		MeshCacheHeader header{};
+		header.magic = MESH_CACHE_MAGIC;
+		header.version = MESH_CACHE_VERSION;
+		header.vertexSize = sizeof(Vertex);
+		header.indexSize = sizeof(uint32_t);
+		header.flags = flags;
+		header.sourceSize = stamp.size;
+		header.sourceTime = stamp.time;
+		header.sourceLoadMs = sourceLoadMs;
+
+		const std::array<std::span<const std::byte>, section::MAX> payload{
+			std::as_bytes(std::span(mesh.vertices)),
+			std::as_bytes(std::span(mesh.indices)),
+			std::as_bytes(std::span(mesh.lods)),
+			std::as_bytes(std::span(mesh.meshlets)),
+		};
+
+		uint64_t offset = alignUp(sizeof(header), MESH_CACHE_ALIGNMENT);
+		for (size_t i = 0; i < payload.size(); ++i)
+		{
+			header.sections[i] = { offset, payload[i].size() };
+			offset = alignUp(offset + payload[i].size(), MESH_CACHE_ALIGNMENT);
+		}
+
+		// - the header, then each section after the zero padding that aligns it
+		static const std::byte padding[MESH_CACHE_ALIGNMENT]{};
+		std::array<std::span<const std::byte>, 1 + 2 * section::MAX> parts;
+		parts[0] = std::as_bytes(std::span(&header, 1));
+		uint64_t written = sizeof(header);
+		for (size_t i = 0; i < payload.size(); ++i)
+		{
+			parts[1 + 2 * i] = std::span(padding, header.sections[i].offset - written);
+			parts[2 + 2 * i] = payload[i];
+			written = header.sections[i].offset + payload[i].size();
+		}
+		return writeFileReplacing(filename, parts);
+	}
+}
+
+namespace
+{
+	void optimizeMesh(MeshData& mesh, const ModelOptions& options)
+	{
+		PROFILE_ZONE("optimizeMesh");
+		static const char* const orderNames[vertex_order::MAX]{ "input", "fetch", "spatial" };
+
+		const auto start = std::chrono::steady_clock::now();
+		const auto vertexCount = mesh.vertices.size();
+		const auto cacheBefore = analyzeVertexCache(mesh.indices, vertexCount);
+		const auto fullBefore = analyzeVertexFetch(mesh.indices, vertexCount, sizeof(Vertex), options.fetchLineSize);
+		const auto compactBefore = analyzeVertexFetch(mesh.indices, vertexCount, sizeof(CompactVertex), options.fetchLineSize);
+
+		if (options.optimizeVertexCache)
+			optimizeVertexCache(mesh.indices, vertexCount);
+
+		if (options.vertexOrder == vertex_order::FETCH)
+			remapVertices(mesh.vertices, mesh.indices, vertexFetchRemap(mesh.indices, vertexCount));
+		else if (options.vertexOrder == vertex_order::SPATIAL)
+			remapVertices(mesh.vertices, mesh.indices, vertexSpatialRemap(mesh.vertices));
+
+		const auto cacheAfter = analyzeVertexCache(mesh.indices, vertexCount);
+		const auto fullAfter = analyzeVertexFetch(mesh.indices, vertexCount, sizeof(Vertex), options.fetchLineSize);
+		const auto compactAfter = analyzeVertexFetch(mesh.indices, vertexCount, sizeof(CompactVertex), options.fetchLineSize);
+
+		std::cout << "Mesh optimization in " << millisecondsSince(start) << " ms (vertex cache "
+			<< (options.optimizeVertexCache ? "on" : "off") << ", " << orderNames[options.vertexOrder] << " vertex order)\n";
+		std::cout << "  ACMR " << cacheBefore.acmr << " -> " << cacheAfter.acmr << ", ATVR " << cacheBefore.atvr
+			<< " -> " << cacheAfter.atvr << " (" << VERTEX_CACHE_SIZE << " entry FIFO)\n";
+		std::cout << "  Overfetch " << fullBefore.overfetch << " -> " << fullAfter.overfetch << " full, "
+			<< compactBefore.overfetch << " -> " << compactAfter.overfetch << " compact ("
+			<< options.fetchLineSize << " byte lines)\n";
+	}
+
+	// Appends the simplified levels to the index buffer and fills in the level table.
+	void buildLods(MeshData& mesh, const ModelOptions& options)
+	{
+		PROFILE_ZONE("buildLods");
+		mesh.lods = { { 0, static_cast<uint32_t>(mesh.indices.size()), 0.0f, 0, 0 } };
+		if (!options.generateLods)
+			return;
+
+		const auto start = std::chrono::steady_clock::now();
+		auto levels = simplifyMesh(mesh.indices, mesh.vertices, LOD_RATIOS);
+		for (auto& level : levels)
+		{
+			// - a level that could not be simplified any further adds nothing over the previous one
+			if (level.indices.size() >= mesh.lods.back().indexCount)
+				continue;
+			if (options.optimizeVertexCache)
+				optimizeVertexCache(level.indices, mesh.vertices.size());
+			mesh.lods.push_back({ static_cast<uint32_t>(mesh.indices.size()), static_cast<uint32_t>(level.indices.size()), level.error, 0, 0 });
+			mesh.indices.insert(mesh.indices.end(), level.indices.begin(), level.indices.end());
+		}
+
+		std::cout << "LOD chain in " << millisecondsSince(start) << " ms:";
+		for (const auto& lod : mesh.lods)
+			std::cout << ' ' << lod.indexCount / 3 << " (" << lod.error << ')';
+		std::cout << " triangles (error)\n";
+	}
+
+	// Splits every level of detail into meshlets, stored level after level.
+	void buildMeshletTable(MeshData& mesh)
+	{
+		PROFILE_ZONE("buildMeshletTable");
+		const auto start = std::chrono::steady_clock::now();
+		mesh.meshlets.clear();
+		for (auto& lod : mesh.lods)
+		{
+			auto meshlets = buildMeshlets(std::span<const uint32_t>(mesh.indices).subspan(lod.firstIndex, lod.indexCount), mesh.vertices);
+			for (auto& meshlet : meshlets)
+				meshlet.firstIndex += lod.firstIndex;
+			lod.firstMeshlet = static_cast<uint32_t>(mesh.meshlets.size());
+			lod.meshletCount = static_cast<uint32_t>(meshlets.size());
+			mesh.meshlets.insert(mesh.meshlets.end(), meshlets.begin(), meshlets.end());
+		}
+
+		size_t vertices = 0;
+		size_t cones = 0;
+		for (const auto& meshlet : mesh.meshlets)
+		{
+			vertices += meshlet.vertexCount;
+			cones += meshlet.cone.w < 1.0f;
+		}
+		std::cout << "Meshlets in " << millisecondsSince(start) << " ms: " << mesh.meshlets.size() << " over "
+			<< mesh.lods.size() << " levels, " << double(vertices) / double(std::max<size_t>(mesh.meshlets.size(), 1))
+			<< " vertices each on average, " << cones << " with a usable normal cone\n";
+	}
+}
+
+glm::vec4 boundingSphere(std::span<const Vertex> vertices)
+{
+	if (vertices.empty())
+		return glm::vec4(0.0f);
+
+	glm::vec3 lower(vertices[0].position);
+	glm::vec3 upper(lower);
+	for (const auto& v : vertices)
+	{
+		lower = glm::min(lower, glm::vec3(v.position));
+		upper = glm::max(upper, glm::vec3(v.position));
+	}
+
+	const auto center = (lower + upper) * 0.5f;
+	float radius = 0.0f;
+	for (const auto& v : vertices)
+		radius = glm::max(radius, glm::distance(center, glm::vec3(v.position)));
+	return glm::vec4(center, radius);
+}
+
+size_t selectLod(std::span<const MeshLod> lods, float pixelsPerUnit, float maxErrorPixels)
+{
+	size_t level = 0;
+	for (size_t i = 1; i < lods.size(); ++i)
+	{
+		if (lods[i].error * pixelsPerUnit > maxErrorPixels)
+			break;
+		level = i;
+	}
+	return level;
+}
+
+bool loadObj(const std::string& filename, MeshData& mesh, ObjLoadStats* stats /*= nullptr*/)
+{
+	PROFILE_ZONE("loadObj");
+	tinyobj::attrib_t attrib;
+	std::vector<tinyobj::shape_t> shapes;
+	std::vector<tinyobj::material_t> materials;
+	std::string warn;
+	std::string err;
+
+	bool ret = tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, filename.c_str(), "");
+
+	if (!warn.empty()) {
+		std::cout << "WARN: " << warn << std::endl;
+	}
+
+	if (!err.empty()) {
+		std::cerr << err << std::endl;
+	}
+
+	if (!ret) {
+		std::cerr << "Failed to load: " << filename << std::endl;
+		return false;
+	}
+
+	size_t faces = 0;
+	for (const auto& shape : shapes) {
+		faces += shape.mesh.indices.size() / 3;
+	}
+
+	// - a closed triangle mesh has about half as many vertices as faces, seams add a few more
+	CornerMap uniqueVertices(faces);
+	mesh.indices.reserve(faces * 3);
+
+	for (const auto& shape : shapes) {
+		for (const auto& index : shape.mesh.indices) {
+			const auto [vertexIndex, inserted] = uniqueVertices.insert(
+				{ index.vertex_index, index.texcoord_index, index.normal_index },
+				static_cast<uint32_t>(mesh.vertices.size()));
+
+			mesh.indices.push_back(vertexIndex);
+			if (!inserted) {
+				continue;
+			}
+
+			Vertex vertex{};
+
+			vertex.position = {
+				attrib.vertices[3 * index.vertex_index + 0],
+				attrib.vertices[3 * index.vertex_index + 1],
+				attrib.vertices[3 * index.vertex_index + 2],
+				1.0f
+			};
+
+			if (index.texcoord_index >= 0) {
+				vertex.texcoord = {
+					attrib.texcoords[2 * index.texcoord_index + 0],
+					attrib.texcoords[2 * index.texcoord_index + 1]
+				};
+			}
+
+			vertex.color = { 1.0f, 1.0f, 1.0f, 1.0f };
+
+			mesh.vertices.push_back(vertex);
+		}
+	}
+
+	if (stats) {
+		*stats = {};
+		stats->dedup = uniqueVertices.stats();
+		stats->peakBytes = capacityBytes(attrib.vertices) + capacityBytes(attrib.vertex_weights) +
+			capacityBytes(attrib.normals) + capacityBytes(attrib.texcoords) + capacityBytes(attrib.texcoord_ws) +
+			capacityBytes(attrib.colors) + uniqueVertices.memoryBytes() +
+			capacityBytes(mesh.vertices) + capacityBytes(mesh.indices);
+		for (const auto& shape : shapes) {
+			stats->peakBytes += capacityBytes(shape.mesh.indices) + capacityBytes(shape.mesh.num_face_vertices) +
+				capacityBytes(shape.mesh.material_ids) + capacityBytes(shape.mesh.smoothing_group_ids);
+		}
+	}
+
+	return true;
+}
+
+namespace
+{
+	struct StreamingState
+	{
+		std::vector<glm::vec3> positions;
+		std::vector<glm::vec2> texcoords;
+		size_t normals = 0;
+		size_t invalidFaces = 0;
+		CornerMap uniqueVertices;
+		MeshData* mesh = nullptr;
+	};
+
+	// Resolves a raw 1-based or relative OBJ index (0 when absent) against the element count.
+	int32_t resolveIndex(int index, size_t count)
+	{
+		if (index > 0)
+			return index - 1;
+		if (index < 0)
+			return static_cast<int32_t>(static_cast<int64_t>(count) + index);
+		return -1;
+	}
+
+	void emitCorner(StreamingState& state, const tinyobj::index_t& index)
+	{
+		const CornerKey key{
+			resolveIndex(index.vertex_index, state.positions.size()),
+			resolveIndex(index.texcoord_index, state.texcoords.size()),
+			resolveIndex(index.normal_index, state.normals)
+		};
+
+		auto& mesh = *state.mesh;
+		const auto [vertexIndex, inserted] = state.uniqueVertices.insert(key, static_cast<uint32_t>(mesh.vertices.size()));
+		mesh.indices.push_back(vertexIndex);
+		if (!inserted)
+			return;
+
+		Vertex vertex{};
+		const auto& p = state.positions[key.position];
+		vertex.position = { p.x, p.y, p.z, 1.0f };
+		if (key.texcoord >= 0)
+			vertex.texcoord = state.texcoords[key.texcoord];
+		vertex.color = { 1.0f, 1.0f, 1.0f, 1.0f };
+		mesh.vertices.push_back(vertex);
+	}
+
+	bool validCorner(const StreamingState& state, const tinyobj::index_t& index)
+	{
+		const auto position = resolveIndex(index.vertex_index, state.positions.size());
+		const auto texcoord = resolveIndex(index.texcoord_index, state.texcoords.size());
+		return position >= 0 && size_t(position) < state.positions.size() &&
+			(index.texcoord_index == 0 || (texcoord >= 0 && size_t(texcoord) < state.texcoords.size()));
+	}
+}
+
+bool loadObjStreaming(const std::string& filename, MeshData& mesh, ObjLoadStats* stats /*= nullptr*/)
+{
+	PROFILE_ZONE("loadObjStreaming");
+	std::ifstream in(filename);
+	if (!in) {
+		std::cerr << "Failed to load: " << filename << std::endl;
+		return false;
+	}
+
+	StreamingState state;
+	state.mesh = &mesh;
+
+	tinyobj::callback_t callback{};
+	callback.vertex_cb = [](void* user, tinyobj::real_t x, tinyobj::real_t y, tinyobj::real_t z, tinyobj::real_t) {
+		static_cast<StreamingState*>(user)->positions.emplace_back(x, y, z);
+	};
+	callback.normal_cb = [](void* user, tinyobj::real_t, tinyobj::real_t, tinyobj::real_t) {
+		++static_cast<StreamingState*>(user)->normals;
+	};
+	callback.texcoord_cb = [](void* user, tinyobj::real_t x, tinyobj::real_t y, tinyobj::real_t) {
+		static_cast<StreamingState*>(user)->texcoords.emplace_back(x, y);
+	};
+	callback.index_cb = [](void* user, tinyobj::index_t* indices, int count) {
+		auto& state = *static_cast<StreamingState*>(user);
+		for (int i = 0; i < count; ++i) {
+			if (!validCorner(state, indices[i])) {
+				++state.invalidFaces;
+				return;
+			}
+		}
+		for (int i = 1; i + 1 < count; ++i) {
+			emitCorner(state, indices[0]);
+			emitCorner(state, indices[i]);
+			emitCorner(state, indices[i + 1]);
+		}
+	};
+
+	std::string warn;
+	std::string err;
+	bool ret = tinyobj::LoadObjWithCallback(in, callback, &state, nullptr, &warn, &err);
+
+	if (!warn.empty()) {
+		std::cout << "WARN: " << warn << std::endl;
+	}
+
+	if (!err.empty()) {
+		std::cerr << err << std::endl;
+	}
+
+	if (state.invalidFaces > 0) {
+		std::cout << "WARN: skipped " << state.invalidFaces << " faces with invalid indices" << std::endl;
+	}
+
+	if (!ret) {
+		std::cerr << "Failed to load: " << filename << std::endl;
+		return false;
+	}
+
+	if (stats) {
+		*stats = {};
+		stats->dedup = state.uniqueVertices.stats();
+		stats->peakBytes = capacityBytes(state.positions) + capacityBytes(state.texcoords) +
+			state.uniqueVertices.memoryBytes() + capacityBytes(mesh.vertices) + capacityBytes(mesh.indices);
+	}
+
+	return true;
+}
+
+std::vector<std::byte> buildCompactVertexBuffer(std::span<const Vertex> vertices)
+{
+	glm::vec3 positionMin(std::numeric_limits<float>::max());
+	glm::vec3 positionMax(std::numeric_limits<float>::lowest());
+	glm::vec2 texcoordMin(std::numeric_limits<float>::max());
+	glm::vec2 texcoordMax(std::numeric_limits<float>::lowest());
+	for (const auto& vertex : vertices)
+	{
+		positionMin = glm::min(positionMin, glm::vec3(vertex.position));
+		positionMax = glm::max(positionMax, glm::vec3(vertex.position));
+		texcoordMin = glm::min(texcoordMin, vertex.texcoord);
+		texcoordMax = glm::max(texcoordMax, vertex.texcoord);
+	}
+
+	// - a flat axis still needs a non-zero scale to keep the division below finite
+	const auto positionScale = glm::max(positionMax - positionMin, glm::vec3(1e-20f));
+	const auto texcoordScale = glm::max(texcoordMax - texcoordMin, glm::vec2(1e-20f));
+
+	std::vector<std::byte> buffer(sizeof(CompactMeshHeader) + vertices.size() * sizeof(CompactVertex));
+	CompactMeshHeader header{};
+	if (!vertices.empty())
+	{
+		header.positionMin = glm::vec4(positionMin, 0.0f);
+		header.positionScale = glm::vec4(positionScale, 0.0f);
+		header.texcoordMinScale = glm::vec4(texcoordMin, texcoordScale);
+	}
+	std::memcpy(buffer.data(), &header, sizeof(header));
+
+	const auto quantize = [](float value) {
+		return static_cast<uint16_t>(glm::clamp(value, 0.0f, 1.0f) * 65535.0f + 0.5f);
+	};
+
+	auto compact = reinterpret_cast<CompactVertex*>(buffer.data() + sizeof(header));
+	for (size_t i = 0; i < vertices.size(); ++i)
+	{
+		const auto p = (glm::vec3(vertices[i].position) - positionMin) / positionScale;
+		const auto t = (vertices[i].texcoord - texcoordMin) / texcoordScale;
+		compact[i] = { { quantize(p.x), quantize(p.y), quantize(p.z) }, 0, { quantize(t.x), quantize(t.y) } };
+	}
+
+	return buffer;
+}
+
+Mesh loadModel(const std::string& filename, const ModelOptions& options /*= {}*/)
+{
+	PROFILE_ZONE("loadModel");
+	static const char* const loaderNames[obj_loader::MAX]{ "parallel", "streaming", "tinyobj" };
+
+	Mesh mesh;
+	const auto start = std::chrono::steady_clock::now();
+	const auto cacheName = cacheFilename(filename);
+
+	FileStamp stamp;
+	const bool hasSource = fileStamp(filename, stamp);
+	const bool useCache = options.cache && hasSource;
+
+	double sourceLoadMs = 0.0;
+	const auto flags = cacheFlags(options);
+	if (useCache && readMeshCache(cacheName, stamp, flags, mesh, sourceLoadMs))
+	{
+		std::cout << "Loaded " << cacheName << " in " << millisecondsSince(start) << " ms (text path: "
+			<< sourceLoadMs << " ms), " << mesh.vertices.size() << " vertices, " << mesh.indices.size() << " indices, " << mesh.lods.size() << " levels of detail\n";
+		return mesh;
+	}
+
+	auto loader = options.loader;
+	ObjLoadStats stats;
+	bool loaded = false;
+	switch (loader)
+	{
+	case obj_loader::PARALLEL:
+		loaded = loadObjParallel(filename, mesh.data, defaultThreadPool(), &stats);
+		if (loaded)
+			break;
+		// - input the parallel parser does not handle goes through tinyobj instead
+		mesh.data = {};
+		loader = obj_loader::TINYOBJ;
+		[[fallthrough]];
+	case obj_loader::TINYOBJ:
+		loaded = loadObj(filename, mesh.data, &stats);
+		break;
+	case obj_loader::STREAMING:
+		loaded = loadObjStreaming(filename, mesh.data, &stats);
+		break;
+	default:
+		break;
+	}
+	if (!loaded)
+		return mesh;
+
+	sourceLoadMs = millisecondsSince(start);
+	const auto& dedup = stats.dedup;
+	std::cout << "Loaded " << filename << " in " << sourceLoadMs << " ms with the " << loaderNames[loader]
+		<< " loader on " << stats.threads << " threads (" << stamp.size / 1048576.0 / (sourceLoadMs / 1000.0) << " MB/s), "
+		<< mesh.data.vertices.size() << " vertices, " << mesh.data.indices.size() << " indices\n";
+	std::cout << "Peak loader memory: " << stats.peakBytes / 1048576.0 << " MB (process peak RSS: "
+		<< peakResidentBytes() / 1048576.0 << " MB)\n";
+	std::cout << "Corner dedup: " << dedup.lookups << " lookups, " << dedup.averageProbe() << " average probes, "
+		<< dedup.maxProbe << " max probes, load factor " << dedup.loadFactor() << ", " << dedup.rehashes << " rehashes\n";
+
+	optimizeMesh(mesh.data, options);
+	buildLods(mesh.data, options);
+	buildMeshletTable(mesh.data);
+
+	if (useCache && !writeMeshCache(cacheName, stamp, flags, mesh.data, sourceLoadMs))
+		std::cerr << "Failed to write mesh cache: " << cacheName << '\n';
+
+	mesh.vertices = mesh.data.vertices;
+	mesh.indices = mesh.data.indices;
+	mesh.lods = mesh.data.lods;
+	mesh.meshlets = mesh.data.meshlets;
+	return mesh;
+}
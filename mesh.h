@@ -0,0 +1,175 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "corner_map.h"
+#include "mapped_file.h"
+
+struct alignas(16) Vertex
+{
+	glm::vec4 position;
+	glm::vec4 color;
+	glm::vec2 texcoord;
+	bool operator==(const Vertex& other) const {
+		return position == other.position && color == other.color && texcoord == other.texcoord;
+	}
+};
+
+// Compact vertex for the SSBO vertex-pulling path: position and texcoord quantized to unorm16
+// against the mesh bounds; color is dropped since the importer always writes white.
+struct CompactVertex
+{
+	uint16_t position[3];
+	uint16_t unused;
+	uint16_t texcoord[2];
+};
+
+// Start of the compact vertex buffer, read by the vertex shader to decode the CompactVertex
+// array that follows it.
+struct alignas(16) CompactMeshHeader
+{
+	glm::vec4 positionMin;
+	glm::vec4 positionScale;
+	glm::vec4 texcoordMinScale;
+};
+
+namespace vertex_format
+{
+	enum type
+	{
+		FULL,
+		COMPACT,
+		MAX
+	};
+}
+
+// Cluster of up to MESHLET_MAX_TRIANGLES triangles drawn as one contiguous range of the index
+// buffer, with the bounds its culling tests need.
+struct alignas(16) Meshlet
+{
+	// - center and radius (w) of a sphere around the meshlet's vertices
+	glm::vec4 sphere;
+	// - average triangle normal and the sine of the cone half angle (w) around it, 1 when the
+	//   normals spread too far for the meshlet to ever face away as a whole
+	glm::vec4 cone;
+	uint32_t firstIndex;
+	uint32_t indexCount;
+	uint32_t vertexCount;
+	uint32_t unused;
+};
+
+// One level of detail: a range of the shared index buffer drawn against the full vertex buffer,
+// and the meshlets that range is split into.
+struct MeshLod
+{
+	uint32_t firstIndex;
+	uint32_t indexCount;
+	// - object space distance the simplified surface may be off by, 0 for the full mesh
+	float error;
+	uint32_t firstMeshlet;
+	uint32_t meshletCount;
+};
+
+// Deduplicated vertices and triangle list indices as produced by the OBJ importer. Once cooked,
+// `indices` holds every level of detail back to back as described by `lods`, finest first.
+struct MeshData
+{
+	std::vector<Vertex> vertices;
+	std::vector<uint32_t> indices;
+	std::vector<MeshLod> lods;
+	std::vector<Meshlet> meshlets;
+};
+
+// Read-only mesh ready for upload. The spans point either into `data` (freshly imported)
+// or straight into `file` (cooked cache hit), so they stay valid as long as the Mesh lives.
+struct Mesh
+{
+	std::span<const Vertex> vertices;
+	std::span<const uint32_t> indices;
+	std::span<const MeshLod> lods;
+	std::span<const Meshlet> meshlets;
+
+	MeshData data;
+	MappedFile file;
+};
+
+namespace obj_loader
+{
+	enum type
+	{
+		PARALLEL,
+		STREAMING,
+		TINYOBJ,
+		MAX
+	};
+}
+
+struct ObjLoadStats
+{
+	CornerMapStats dedup;
+	// - bytes held by the loader's own arrays at the point where they are all alive together
+	size_t peakBytes = 0;
+	unsigned threads = 1;
+};
+
+namespace vertex_order
+{
+	enum type
+	{
+		// - as the importer emitted them
+		INPUT,
+		// - in the order the index buffer first references them
+		FETCH,
+		// - along a Morton curve through the positions
+		SPATIAL,
+		MAX
+	};
+}
+
+struct ModelOptions
+{
+	obj_loader::type loader = obj_loader::PARALLEL;
+	bool cache = true;
+	bool optimizeVertexCache = true;
+	vertex_order::type vertexOrder = vertex_order::FETCH;
+	// - cache line size the vertex fetch report is simulated with
+	size_t fetchLineSize = 64;
+	bool generateLods = true;
+};
+
+// - triangle counts of the generated levels of detail, as fractions of the full mesh
+constexpr float LOD_RATIOS[]{ 0.5f, 0.25f, 0.1f, 0.03f };
+
+// Center and radius (w) of a sphere enclosing all vertex positions.
+glm::vec4 boundingSphere(std::span<const Vertex> vertices);
+
+// Picks the coarsest level whose error, scaled by `pixelsPerUnit` (screen pixels per object
+// space unit at the mesh's distance), stays within `maxErrorPixels`.
+size_t selectLod(std::span<const MeshLod> lods, float pixelsPerUnit, float maxErrorPixels);
+
+// Builds a CompactMeshHeader followed by the quantized vertices, ready for glNamedBufferStorage.
+std::vector<std::byte> buildCompactVertexBuffer(std::span<const Vertex> vertices);
+
+template<typename T>
+size_t capacityBytes(const std::vector<T>& v)
+{
+	return v.capacity() * sizeof(T);
+}
+
+// Imports through tinyobj::LoadObj, keeping the whole attrib_t/shape_t representation around.
+bool loadObj(const std::string& filename, MeshData& mesh, ObjLoadStats* stats = nullptr);
+
+// Imports through tinyobj::LoadObjWithCallback, emitting deduplicated vertices and indices as
+// faces arrive. Only the position and texcoord arrays and the corner map are kept on the side.
+// Polygons with more than three corners are triangulated as fans.
+bool loadObjStreaming(const std::string& filename, MeshData& mesh, ObjLoadStats* stats = nullptr);
+
+// Loads `filename` through the cooked cache stored next to it, importing and cooking the OBJ
+// when the cache is missing or older than the source.
+Mesh loadModel(const std::string& filename, const ModelOptions& options = {});
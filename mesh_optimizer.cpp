@@ -0,0 +1,716 @@
+#include "mesh_optimizer.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+	// Triangles incident to every vertex, stored as one flat array with per-vertex offsets.
+	struct Adjacency
+	{
+		std::vector<uint32_t> offsets;
+		std::vector<uint32_t> triangles;
+
+		Adjacency(std::span<const uint32_t> indices, size_t vertexCount)
+			: offsets(vertexCount + 1, 0), triangles(indices.size())
+		{
+			for (const auto index : indices)
+				++offsets[index + 1];
+			for (size_t v = 0; v < vertexCount; ++v)
+				offsets[v + 1] += offsets[v];
+
+			std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+			for (size_t i = 0; i < indices.size(); ++i)
+				triangles[cursor[indices[i]]++] = static_cast<uint32_t>(i / 3);
+		}
+
+		std::span<const uint32_t> of(uint32_t vertex) const
+		{
+			return { triangles.data() + offsets[vertex], offsets[vertex + 1] - offsets[vertex] };
+		}
+	};
+}
+
+VertexCacheStats analyzeVertexCache(std::span<const uint32_t> indices, size_t vertexCount,
+	unsigned cacheSize /*= VERTEX_CACHE_SIZE*/)
+{
+	VertexCacheStats stats;
+	if (indices.empty() || vertexCount == 0)
+		return stats;
+
+	// - a vertex is in the FIFO while fewer than cacheSize misses happened since it was loaded
+	std::vector<size_t> loadedAt(vertexCount, 0);
+	size_t misses = 0;
+	for (const auto index : indices)
+	{
+		if (loadedAt[index] == 0 || misses - loadedAt[index] >= cacheSize)
+		{
+			++misses;
+			loadedAt[index] = misses;
+		}
+	}
+
+	stats.acmr = double(misses) / double(indices.size() / 3);
+	stats.atvr = double(misses) / double(vertexCount);
+	return stats;
+}
+
+void optimizeVertexCache(std::span<uint32_t> indices, size_t vertexCount, unsigned cacheSize /*= VERTEX_CACHE_SIZE*/)
+{
+	const size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0 || vertexCount == 0)
+		return;
+
+	const Adjacency adjacency(indices, vertexCount);
+
+	std::vector<uint32_t> liveTriangles(vertexCount);
+	for (uint32_t v = 0; v < vertexCount; ++v)
+		liveTriangles[v] = static_cast<uint32_t>(adjacency.of(v).size());
+
+	std::vector<size_t> cacheTime(vertexCount, 0);
+	std::vector<char> emitted(triangleCount, 0);
+	std::vector<uint32_t> deadEnd;
+	std::vector<uint32_t> candidates;
+	std::vector<uint32_t> output;
+	output.reserve(indices.size());
+
+	size_t time = cacheSize + 1;
+	size_t cursor = 0;
+
+	// - next vertex with live triangles: the dead-end stack first, then input order
+	const auto skipDeadEnd = [&]() -> int64_t {
+		while (!deadEnd.empty())
+		{
+			const auto v = deadEnd.back();
+			deadEnd.pop_back();
+			if (liveTriangles[v] > 0)
+				return v;
+		}
+		while (cursor < vertexCount)
+		{
+			if (liveTriangles[cursor] > 0)
+				return static_cast<int64_t>(cursor++);
+			++cursor;
+		}
+		return -1;
+	};
+
+	for (int64_t fan = skipDeadEnd(); fan >= 0;)
+	{
+		candidates.clear();
+		for (const auto t : adjacency.of(static_cast<uint32_t>(fan)))
+		{
+			if (emitted[t])
+				continue;
+			for (size_t k = 0; k < 3; ++k)
+			{
+				const auto v = indices[3 * t + k];
+				output.push_back(v);
+				deadEnd.push_back(v);
+				candidates.push_back(v);
+				--liveTriangles[v];
+				if (time - cacheTime[v] > cacheSize)
+					cacheTime[v] = time++;
+			}
+			emitted[t] = 1;
+		}
+
+		// - prefer the candidate that stays in the cache longest while its remaining fan fits
+		int64_t best = -1;
+		int64_t bestPriority = -1;
+		for (const auto v : candidates)
+		{
+			if (liveTriangles[v] == 0)
+				continue;
+			int64_t priority = 0;
+			if (time - cacheTime[v] + 2 * liveTriangles[v] <= cacheSize)
+				priority = static_cast<int64_t>(time - cacheTime[v]);
+			if (priority > bestPriority)
+			{
+				best = v;
+				bestPriority = priority;
+			}
+		}
+
+		fan = best >= 0 ? best : skipDeadEnd();
+	}
+
+	std::copy(output.begin(), output.end(), indices.begin());
+}
+
+VertexFetchStats analyzeVertexFetch(std::span<const uint32_t> indices, size_t vertexCount, size_t vertexSize,
+	size_t lineSize, unsigned cacheSize /*= VERTEX_CACHE_SIZE*/)
+{
+	VertexFetchStats stats;
+	if (indices.empty() || vertexCount == 0 || vertexSize == 0 || lineSize == 0)
+		return stats;
+
+	const size_t cacheLines = std::max<size_t>(1, VERTEX_FETCH_CACHE_BYTES / lineSize);
+	std::vector<size_t> vertexLoadedAt(vertexCount, 0);
+	std::vector<size_t> lineLoadedAt((vertexCount * vertexSize + lineSize - 1) / lineSize, 0);
+	size_t vertexMisses = 0;
+	size_t lineMisses = 0;
+
+	for (const auto index : indices)
+	{
+		if (vertexLoadedAt[index] != 0 && vertexMisses - vertexLoadedAt[index] < cacheSize)
+			continue;
+		vertexLoadedAt[index] = ++vertexMisses;
+
+		const size_t first = index * vertexSize / lineSize;
+		const size_t last = ((index + 1) * vertexSize - 1) / lineSize;
+		for (size_t line = first; line <= last; ++line)
+		{
+			if (lineLoadedAt[line] != 0 && lineMisses - lineLoadedAt[line] < cacheLines)
+				continue;
+			lineLoadedAt[line] = ++lineMisses;
+		}
+	}
+
+	stats.overfetch = double(lineMisses * lineSize) / double(vertexCount * vertexSize);
+	return stats;
+}
+
+std::vector<uint32_t> vertexFetchRemap(std::span<const uint32_t> indices, size_t vertexCount)
+{
+	constexpr auto UNUSED = std::numeric_limits<uint32_t>::max();
+	std::vector<uint32_t> remap(vertexCount, UNUSED);
+	uint32_t next = 0;
+	for (const auto index : indices)
+	{
+		if (remap[index] == UNUSED)
+			remap[index] = next++;
+	}
+	for (auto& r : remap)
+	{
+		if (r == UNUSED)
+			r = next++;
+	}
+	return remap;
+}
+
+namespace
+{
+	// Spreads the low 10 bits of v so there are two zero bits between each of them.
+	uint32_t spreadBits(uint32_t v)
+	{
+		v &= 0x3ff;
+		v = (v | (v << 16)) & 0x030000ff;
+		v = (v | (v << 8)) & 0x0300f00f;
+		v = (v | (v << 4)) & 0x030c30c3;
+		v = (v | (v << 2)) & 0x09249249;
+		return v;
+	}
+}
+
+std::vector<uint32_t> vertexSpatialRemap(std::span<const Vertex> vertices)
+{
+	glm::vec3 minimum(std::numeric_limits<float>::max());
+	glm::vec3 maximum(std::numeric_limits<float>::lowest());
+	for (const auto& vertex : vertices)
+	{
+		minimum = glm::min(minimum, glm::vec3(vertex.position));
+		maximum = glm::max(maximum, glm::vec3(vertex.position));
+	}
+
+	// - one scale for all axes keeps the curve's cells cubic
+	const float extent = glm::max(glm::max(maximum.x - minimum.x, maximum.y - minimum.y), maximum.z - minimum.z);
+	const float scale = extent > 0.0f ? 1023.0f / extent : 0.0f;
+
+	std::vector<uint32_t> codes(vertices.size());
+	for (size_t i = 0; i < vertices.size(); ++i)
+	{
+		const auto q = glm::uvec3((glm::vec3(vertices[i].position) - minimum) * scale + 0.5f);
+		codes[i] = spreadBits(q.x) | spreadBits(q.y) << 1 | spreadBits(q.z) << 2;
+	}
+
+	std::vector<uint32_t> order(vertices.size());
+	std::iota(order.begin(), order.end(), 0u);
+	std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return codes[a] < codes[b]; });
+
+	std::vector<uint32_t> remap(vertices.size());
+	for (size_t i = 0; i < order.size(); ++i)
+		remap[order[i]] = static_cast<uint32_t>(i);
+	return remap;
+}
+
+void remapVertices(std::vector<Vertex>& vertices, std::span<uint32_t> indices, std::span<const uint32_t> remap)
+{
+	std::vector<Vertex> remapped(vertices.size());
+	for (size_t v = 0; v < vertices.size(); ++v)
+		remapped[remap[v]] = vertices[v];
+	vertices.swap(remapped);
+
+	for (auto& index : indices)
+		index = remap[index];
+}
+
+namespace
+{
+	// Symmetric 4x4 error quadric, plus the total weight of the planes summed into it.
+	struct Quadric
+	{
+		double a00 = 0, a01 = 0, a02 = 0, a03 = 0;
+		double a11 = 0, a12 = 0, a13 = 0;
+		double a22 = 0, a23 = 0;
+		double a33 = 0;
+		double weight = 0;
+
+		void addPlane(const glm::dvec3& n, double d, double w)
+		{
+			a00 += w * n.x * n.x; a01 += w * n.x * n.y; a02 += w * n.x * n.z; a03 += w * n.x * d;
+			a11 += w * n.y * n.y; a12 += w * n.y * n.z; a13 += w * n.y * d;
+			a22 += w * n.z * n.z; a23 += w * n.z * d;
+			a33 += w * d * d;
+			weight += w;
+		}
+
+		Quadric& operator+=(const Quadric& q)
+		{
+			a00 += q.a00; a01 += q.a01; a02 += q.a02; a03 += q.a03;
+			a11 += q.a11; a12 += q.a12; a13 += q.a13;
+			a22 += q.a22; a23 += q.a23;
+			a33 += q.a33;
+			weight += q.weight;
+			return *this;
+		}
+
+		// - weighted sum of squared plane distances of p
+		double evaluate(const glm::dvec3& p) const
+		{
+			const double x = p.x, y = p.y, z = p.z;
+			return a00 * x * x + 2 * a01 * x * y + 2 * a02 * x * z + 2 * a03 * x +
+				a11 * y * y + 2 * a12 * y * z + 2 * a13 * y +
+				a22 * z * z + 2 * a23 * z +
+				a33;
+		}
+	};
+
+	struct Collapse
+	{
+		double cost;
+		uint32_t from;
+		uint32_t to;
+		uint32_t fromVersion;
+		uint32_t toVersion;
+		bool operator>(const Collapse& other) const { return cost > other.cost; }
+	};
+
+	// Edge collapse state. Positions are welded into groups so UV seams (several vertices at one
+	// position) collapse together; triangles keep indexing the original vertices.
+	class Simplifier
+	{
+	public:
+		Simplifier(std::span<const uint32_t> indices, std::span<const Vertex> vertices)
+		{
+			weldPositions(vertices);
+
+			triangles_.reserve(indices.size() / 3);
+			for (size_t i = 0; i + 2 < indices.size(); i += 3)
+			{
+				const std::array<uint32_t, 3> t{ indices[i], indices[i + 1], indices[i + 2] };
+				if (group(t[0]) == group(t[1]) || group(t[1]) == group(t[2]) || group(t[0]) == group(t[2]))
+					continue;
+				triangles_.push_back(t);
+			}
+			alive_.assign(triangles_.size(), 1);
+			liveTriangles_ = triangles_.size();
+
+			groupTriangles_.resize(positions_.size());
+			quadrics_.resize(positions_.size());
+			for (uint32_t t = 0; t < triangles_.size(); ++t)
+			{
+				const auto& tri = triangles_[t];
+				const auto p0 = positions_[group(tri[0])];
+				const auto normal = glm::cross(positions_[group(tri[1])] - p0, positions_[group(tri[2])] - p0);
+				const double length = glm::length(normal);
+				for (const auto v : tri)
+				{
+					groupTriangles_[group(v)].push_back(t);
+					if (length > 0.0)
+					{
+						const auto n = normal / length;
+						quadrics_[group(v)].addPlane(n, -glm::dot(n, p0), length * 0.5);
+					}
+				}
+			}
+
+			lockBorders();
+
+			removed_.assign(positions_.size(), 0);
+			version_.assign(positions_.size(), 0);
+			for (const auto& tri : triangles_)
+			{
+				for (size_t k = 0; k < 3; ++k)
+				{
+					const auto a = group(tri[k]);
+					const auto b = group(tri[(k + 1) % 3]);
+					pushCollapse(a, b);
+					pushCollapse(b, a);
+				}
+			}
+		}
+
+		size_t liveTriangles() const { return liveTriangles_; }
+
+		// Collapses the cheapest valid edges until at most `target` triangles are left.
+		void run(size_t target)
+		{
+			while (liveTriangles_ > target && !heap_.empty())
+			{
+				const auto c = heap_.top();
+				heap_.pop();
+				if (removed_[c.from] || removed_[c.to] || version_[c.from] != c.fromVersion || version_[c.to] != c.toVersion)
+					continue;
+				if (collapse(c.from, c.to))
+					error_ = std::max(error_, static_cast<float>(std::sqrt(std::max(c.cost, 0.0))));
+			}
+		}
+
+		SimplifiedLevel level() const
+		{
+			SimplifiedLevel result;
+			result.indices.reserve(liveTriangles_ * 3);
+			for (size_t t = 0; t < triangles_.size(); ++t)
+			{
+				if (alive_[t])
+					result.indices.insert(result.indices.end(), triangles_[t].begin(), triangles_[t].end());
+			}
+			result.error = error_;
+			return result;
+		}
+
+	private:
+		uint32_t group(uint32_t vertex) const { return groupOf_[vertex]; }
+
+		void weldPositions(std::span<const Vertex> vertices)
+		{
+			std::unordered_map<uint64_t, std::vector<uint32_t>> buckets;
+			groupOf_.resize(vertices.size());
+			for (uint32_t v = 0; v < vertices.size(); ++v)
+			{
+				// - adding zero folds -0.0 into 0.0 so both weld together
+				const glm::vec3 p = glm::vec3(vertices[v].position) + glm::vec3(0.0f);
+				uint32_t bits[3];
+				std::memcpy(bits, &p, sizeof(bits));
+				const uint64_t key = (uint64_t(bits[0]) * 0x9e3779b97f4a7c15ull) ^ (uint64_t(bits[1]) << 21) ^ (uint64_t(bits[2]) << 42) ^ bits[2];
+
+				auto& bucket = buckets[key];
+				const auto match = std::find_if(bucket.begin(), bucket.end(),
+					[&](uint32_t g) { return positions_[g] == glm::dvec3(p); });
+				if (match != bucket.end())
+				{
+					groupOf_[v] = *match;
+				}
+				else
+				{
+					groupOf_[v] = static_cast<uint32_t>(positions_.size());
+					bucket.push_back(groupOf_[v]);
+					positions_.emplace_back(p);
+				}
+			}
+		}
+
+		// Open and non-manifold edges keep both of their ends in place.
+		void lockBorders()
+		{
+			std::unordered_map<uint64_t, uint32_t> edgeUse;
+			for (const auto& tri : triangles_)
+			{
+				for (size_t k = 0; k < 3; ++k)
+				{
+					const auto a = group(tri[k]);
+					const auto b = group(tri[(k + 1) % 3]);
+					++edgeUse[uint64_t(std::min(a, b)) << 32 | std::max(a, b)];
+				}
+			}
+
+			locked_.assign(positions_.size(), 0);
+			for (const auto& [edge, count] : edgeUse)
+			{
+				if (count == 2)
+					continue;
+				locked_[edge >> 32] = 1;
+				locked_[edge & 0xffffffff] = 1;
+			}
+		}
+
+		void pushCollapse(uint32_t from, uint32_t to)
+		{
+			if (locked_[from])
+				return;
+			auto q = quadrics_[from];
+			q += quadrics_[to];
+			const double cost = q.weight > 0.0 ? q.evaluate(positions_[to]) / q.weight : 0.0;
+			heap_.push({ cost, from, to, version_[from], version_[to] });
+		}
+
+		bool containsGroup(uint32_t t, uint32_t g) const
+		{
+			const auto& tri = triangles_[t];
+			return group(tri[0]) == g || group(tri[1]) == g || group(tri[2]) == g;
+		}
+
+		// Drops dead and stale entries from the triangle list of group g.
+		std::vector<uint32_t>& liveTrianglesOf(uint32_t g)
+		{
+			auto& list = groupTriangles_[g];
+			list.erase(std::remove_if(list.begin(), list.end(),
+				[&](uint32_t t) { return !alive_[t] || !containsGroup(t, g); }), list.end());
+			std::sort(list.begin(), list.end());
+			list.erase(std::unique(list.begin(), list.end()), list.end());
+			return list;
+		}
+
+		void neighbours(uint32_t g, std::vector<uint32_t>& out)
+		{
+			out.clear();
+			for (const auto t : liveTrianglesOf(g))
+			{
+				for (const auto v : triangles_[t])
+				{
+					if (group(v) != g)
+						out.push_back(group(v));
+				}
+			}
+			std::sort(out.begin(), out.end());
+			out.erase(std::unique(out.begin(), out.end()), out.end());
+		}
+
+		bool collapse(uint32_t from, uint32_t to)
+		{
+			const auto& fromTriangles = liveTrianglesOf(from);
+
+			// - link condition: the edge may only share the neighbours of the triangles on it,
+			//   otherwise the collapse pinches the surface into a non-manifold fan
+			size_t shared = 0;
+			for (const auto t : fromTriangles)
+				shared += containsGroup(t, to);
+			neighbours(from, scratchA_);
+			neighbours(to, scratchB_);
+			size_t common = 0;
+			for (size_t i = 0, j = 0; i < scratchA_.size() && j < scratchB_.size();)
+			{
+				if (scratchA_[i] < scratchB_[j])
+					++i;
+				else if (scratchB_[j] < scratchA_[i])
+					++j;
+				else
+					++common, ++i, ++j;
+			}
+			if (shared == 0 || common > shared)
+				return false;
+
+			// - every vertex at `from` moves onto the vertex at `to` on the same side of any seam
+			wedgeMap_.clear();
+			for (const auto t : fromTriangles)
+			{
+				const auto& tri = triangles_[t];
+				for (size_t k = 0; k < 3; ++k)
+				{
+					if (group(tri[k]) != from)
+						continue;
+					for (const auto v : tri)
+					{
+						if (group(v) == to)
+							wedgeMap_.emplace_back(tri[k], v);
+					}
+				}
+			}
+			for (const auto t : fromTriangles)
+			{
+				for (const auto v : triangles_[t])
+				{
+					if (group(v) == from && mappedWedge(v) == UINT32_MAX)
+						return false;
+				}
+			}
+
+			// - reject collapses that flip or flatten a remaining triangle
+			for (const auto t : fromTriangles)
+			{
+				if (containsGroup(t, to))
+					continue;
+				const auto& tri = triangles_[t];
+				glm::dvec3 p[3];
+				glm::dvec3 q[3];
+				for (size_t k = 0; k < 3; ++k)
+				{
+					p[k] = positions_[group(tri[k])];
+					q[k] = group(tri[k]) == from ? positions_[to] : p[k];
+				}
+				const auto before = glm::cross(p[1] - p[0], p[2] - p[0]);
+				const auto after = glm::cross(q[1] - q[0], q[2] - q[0]);
+				if (glm::dot(before, after) <= 0.0)
+					return false;
+			}
+
+			auto& toTriangles = groupTriangles_[to];
+			for (const auto t : fromTriangles)
+			{
+				if (containsGroup(t, to))
+				{
+					alive_[t] = 0;
+					--liveTriangles_;
+					continue;
+				}
+				for (auto& v : triangles_[t])
+				{
+					if (group(v) == from)
+						v = mappedWedge(v);
+				}
+				toTriangles.push_back(t);
+			}
+
+			quadrics_[to] += quadrics_[from];
+			removed_[from] = 1;
+			groupTriangles_[from].clear();
+			++version_[to];
+
+			neighbours(to, scratchA_);
+			for (const auto g : scratchA_)
+			{
+				pushCollapse(g, to);
+				pushCollapse(to, g);
+			}
+			return true;
+		}
+
+		uint32_t mappedWedge(uint32_t v) const
+		{
+			for (const auto& [from, to] : wedgeMap_)
+			{
+				if (from == v)
+					return to;
+			}
+			return UINT32_MAX;
+		}
+
+		std::vector<uint32_t> groupOf_;
+		std::vector<glm::dvec3> positions_;
+		std::vector<std::array<uint32_t, 3>> triangles_;
+		std::vector<char> alive_;
+		size_t liveTriangles_ = 0;
+		std::vector<std::vector<uint32_t>> groupTriangles_;
+		std::vector<Quadric> quadrics_;
+		std::vector<char> locked_;
+		std::vector<char> removed_;
+		std::vector<uint32_t> version_;
+		std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> heap_;
+		std::vector<std::pair<uint32_t, uint32_t>> wedgeMap_;
+		std::vector<uint32_t> scratchA_;
+		std::vector<uint32_t> scratchB_;
+		float error_ = 0.0f;
+	};
+}
+
+std::vector<SimplifiedLevel> simplifyMesh(std::span<const uint32_t> indices, std::span<const Vertex> vertices,
+	std::span<const float> ratios)
+{
+	std::vector<SimplifiedLevel> levels;
+	Simplifier simplifier(indices, vertices);
+	const size_t triangleCount = indices.size() / 3;
+	for (const auto ratio : ratios)
+	{
+		simplifier.run(static_cast<size_t>(double(triangleCount) * ratio));
+		levels.push_back(simplifier.level());
+	}
+	return levels;
+}
+
+namespace
+{
+	void computeMeshletBounds(Meshlet& meshlet, std::span<const uint32_t> indices, std::span<const Vertex> vertices)
+	{
+		const auto triangles = indices.subspan(meshlet.firstIndex, meshlet.indexCount);
+
+		glm::vec3 lower(vertices[triangles[0]].position);
+		glm::vec3 upper(lower);
+		for (const auto v : triangles)
+		{
+			lower = glm::min(lower, glm::vec3(vertices[v].position));
+			upper = glm::max(upper, glm::vec3(vertices[v].position));
+		}
+		const auto center = (lower + upper) * 0.5f;
+		float radius = 0.0f;
+		for (const auto v : triangles)
+			radius = glm::max(radius, glm::distance(center, glm::vec3(vertices[v].position)));
+		meshlet.sphere = glm::vec4(center, radius);
+
+		std::vector<glm::vec3> normals;
+		normals.reserve(triangles.size() / 3);
+		glm::vec3 sum(0.0f);
+		for (size_t i = 0; i + 2 < triangles.size(); i += 3)
+		{
+			const glm::vec3 p0(vertices[triangles[i + 0]].position);
+			const glm::vec3 p1(vertices[triangles[i + 1]].position);
+			const glm::vec3 p2(vertices[triangles[i + 2]].position);
+			const auto normal = glm::cross(p1 - p0, p2 - p0);
+			const float length = glm::length(normal);
+			if (length <= 0.0f)
+				continue;
+			normals.push_back(normal / length);
+			sum += normals.back();
+		}
+
+		// - no cone once the normals spread past about 84 degrees from the axis
+		meshlet.cone = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+		const float sumLength = glm::length(sum);
+		if (normals.empty() || sumLength <= 0.0f)
+			return;
+		const auto axis = sum / sumLength;
+		float minDot = 1.0f;
+		for (const auto& n : normals)
+			minDot = glm::min(minDot, glm::dot(n, axis));
+		if (minDot <= 0.1f)
+			return;
+		meshlet.cone = glm::vec4(axis, glm::sqrt(1.0f - minDot * minDot));
+	}
+}
+
+std::vector<Meshlet> buildMeshlets(std::span<const uint32_t> indices, std::span<const Vertex> vertices,
+	size_t maxVertices /*= MESHLET_MAX_VERTICES*/, size_t maxTriangles /*= MESHLET_MAX_TRIANGLES*/)
+{
+	std::vector<Meshlet> meshlets;
+	// - last meshlet each vertex was counted in, so the unique vertex count stays O(1) per corner
+	std::vector<uint32_t> seenIn(vertices.size(), UINT32_MAX);
+
+	// - vertices of triangle i not yet in the meshlet being filled; a repeated corner counts once
+	const auto newVertices = [&](size_t i) {
+		const auto id = static_cast<uint32_t>(meshlets.size());
+		const auto a = indices[i], b = indices[i + 1], c = indices[i + 2];
+		return size_t(seenIn[a] != id) + size_t(b != a && seenIn[b] != id) + size_t(c != a && c != b && seenIn[c] != id);
+	};
+
+	Meshlet current{};
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+	{
+		auto added = newVertices(i);
+		if (current.indexCount > 0 && (current.vertexCount + added > maxVertices || current.indexCount / 3 >= maxTriangles))
+		{
+			meshlets.push_back(current);
+			current = { .firstIndex = static_cast<uint32_t>(i) };
+			added = newVertices(i);
+		}
+
+		const auto id = static_cast<uint32_t>(meshlets.size());
+		for (size_t k = 0; k < 3; ++k)
+			seenIn[indices[i + k]] = id;
+		current.vertexCount += static_cast<uint32_t>(added);
+		current.indexCount += 3;
+	}
+	if (current.indexCount > 0)
+		meshlets.push_back(current);
+
+	for (auto& meshlet : meshlets)
+		computeMeshletBounds(meshlet, indices, vertices);
+	return meshlets;
+}
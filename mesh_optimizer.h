@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "mesh.h"
+
+// - FIFO size used both to optimize and to evaluate index order; typical for desktop GPUs
+constexpr unsigned VERTEX_CACHE_SIZE = 16;
+
+// - meshlet limits: 64 vertices and 124 triangles keep a cluster within common mesh shader budgets
+constexpr size_t MESHLET_MAX_VERTICES = 64;
+constexpr size_t MESHLET_MAX_TRIANGLES = 124;
+
+// - size of the small line cache that vertex fetches are simulated against
+constexpr unsigned VERTEX_FETCH_CACHE_BYTES = 4096;
+
+struct VertexCacheStats
+{
+	// - average cache miss ratio: transformed vertices per triangle, 0.5 is the ideal for large meshes
+	double acmr = 0.0;
+	// - average transform to vertex ratio: transformed vertices per unique vertex, 1.0 is the ideal
+	double atvr = 0.0;
+};
+
+// Simulates a FIFO post-transform cache of `cacheSize` entries over a triangle list.
+VertexCacheStats analyzeVertexCache(std::span<const uint32_t> indices, size_t vertexCount,
+	unsigned cacheSize = VERTEX_CACHE_SIZE);
+
+// Reorders the triangles of a triangle list for post-transform cache locality using Tipsify
+// (Sander, Nehab, Barczak 2007). The vertices themselves are not touched.
+void optimizeVertexCache(std::span<uint32_t> indices, size_t vertexCount, unsigned cacheSize = VERTEX_CACHE_SIZE);
+
+struct VertexFetchStats
+{
+	// - bytes pulled through cache lines per byte of vertex data, 1.0 is the ideal
+	double overfetch = 0.0;
+};
+
+// Simulates the memory side of vertex pulling: every post-transform cache miss reads its
+// vertex through `lineSize` byte cache lines held in a small FIFO line cache.
+VertexFetchStats analyzeVertexFetch(std::span<const uint32_t> indices, size_t vertexCount, size_t vertexSize,
+	size_t lineSize, unsigned cacheSize = VERTEX_CACHE_SIZE);
+
+// Old-to-new vertex numbering in the order the index buffer first references each vertex.
+// Unreferenced vertices go to the end.
+std::vector<uint32_t> vertexFetchRemap(std::span<const uint32_t> indices, size_t vertexCount);
+
+// Old-to-new vertex numbering along a Morton curve through the vertex positions.
+std::vector<uint32_t> vertexSpatialRemap(std::span<const Vertex> vertices);
+
+// Renumbers vertices and indices with an old-to-new table from one of the functions above.
+void remapVertices(std::vector<Vertex>& vertices, std::span<uint32_t> indices, std::span<const uint32_t> remap);
+
+struct SimplifiedLevel
+{
+	std::vector<uint32_t> indices;
+	// - object space distance the surface moved by, from the collapse quadrics
+	float error = 0.0f;
+};
+
+// Simplifies a triangle list with quadric error half-edge collapses (Garland and Heckbert
+// 1997) that only move vertices onto existing ones, so every level indexes the original vertex
+// buffer. One level is returned per entry of `ratios` (fractions of the input triangle count,
+// in decreasing order), each simplified further from the previous one. Vertices on open borders
+// are kept and UV seams only collapse along the seam.
+std::vector<SimplifiedLevel> simplifyMesh(std::span<const uint32_t> indices, std::span<const Vertex> vertices,
+	std::span<const float> ratios);
+
+// Splits a triangle list into meshlets by scanning its triangles in order, so the list should
+// already be sorted for locality (see optimizeVertexCache); the triangle order is kept, which
+// makes every meshlet one contiguous range. Each meshlet's firstIndex is relative to `indices`.
+std::vector<Meshlet> buildMeshlets(std::span<const uint32_t> indices, std::span<const Vertex> vertices,
+	size_t maxVertices = MESHLET_MAX_VERTICES, size_t maxTriangles = MESHLET_MAX_TRIANGLES);
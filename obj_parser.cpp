@@ -0,0 +1,407 @@
+#include "obj_parser.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "corner_map.h"
+#include "mapped_file.h"
+#include "profile.h"
+#include "thread_pool.h"
+
+// - the parallel parser reuses tinyobj's number parser so both paths round values identically
+#define TINYOBJLOADER_IMPLEMENTATION
+#include <tiny_obj_loader.h>
+
+namespace
+{
+	// - below this many bytes per chunk the task overhead outweighs the parsing work
+	constexpr size_t MIN_CHUNK_SIZE = 256 * 1024;
+
+	struct Chunk
+	{
+		const char* begin = nullptr;
+		const char* end = nullptr;
+
+		// - filled by the counting pass
+		size_t positions = 0;
+		size_t texcoords = 0;
+		size_t normals = 0;
+		size_t corners = 0;
+		bool unsupported = false;
+
+		// - prefix sums of the counts above, i.e. where this chunk writes its output
+		size_t positionBase = 0;
+		size_t texcoordBase = 0;
+		size_t normalBase = 0;
+		size_t cornerBase = 0;
+		size_t vertexBase = 0;
+	};
+
+	inline bool isSpace(char c)
+	{
+		return c == ' ' || c == '\t';
+	}
+
+	inline const char* skipSpace(const char* p, const char* end)
+	{
+		while (p < end && isSpace(*p))
+			++p;
+		return p;
+	}
+
+	inline const char* tokenEnd(const char* p, const char* end)
+	{
+		while (p < end && !isSpace(*p) && *p != '\r')
+			++p;
+		return p;
+	}
+
+	inline const char* lineEnd(const char* p, const char* end)
+	{
+		const auto newline = static_cast<const char*>(std::memchr(p, '\n', static_cast<size_t>(end - p)));
+		return newline ? newline : end;
+	}
+
+	float parseReal(const char*& p, const char* end, double defaultValue)
+	{
+		p = skipSpace(p, end);
+		const char* e = tokenEnd(p, end);
+		double value = defaultValue;
+		tinyobj::tryParseDouble(p, e, &value);
+		p = e;
+		return static_cast<float>(value);
+	}
+
+	int parseIndex(const char*& p, const char* end)
+	{
+		bool negative = false;
+		if (p < end && (*p == '-' || *p == '+'))
+			negative = *p++ == '-';
+		int value = 0;
+		while (p < end && *p >= '0' && *p <= '9')
+			value = value * 10 + (*p++ - '0');
+		return negative ? -value : value;
+	}
+
+	// Resolves a 1-based or relative OBJ index against the number of elements seen so far.
+	inline int32_t fixIndex(int index, size_t count)
+	{
+		if (index > 0)
+			return index - 1;
+		if (index < 0)
+			return static_cast<int32_t>(static_cast<int64_t>(count) + index);
+		return -1;
+	}
+
+	enum class LineType
+	{
+		OTHER,
+		POSITION,
+		TEXCOORD,
+		NORMAL,
+		FACE
+	};
+
+	// Classifies the line starting at p and moves p past its keyword.
+	LineType classify(const char*& p, const char* end)
+	{
+		p = skipSpace(p, end);
+		const auto remaining = end - p;
+		if (remaining >= 2 && p[0] == 'v' && isSpace(p[1]))
+		{
+			p += 2;
+			return LineType::POSITION;
+		}
+		if (remaining >= 3 && p[0] == 'v' && isSpace(p[2]))
+		{
+			const auto type = p[1] == 't' ? LineType::TEXCOORD : p[1] == 'n' ? LineType::NORMAL : LineType::OTHER;
+			p += 3;
+			return type;
+		}
+		if (remaining >= 2 && p[0] == 'f' && isSpace(p[1]))
+		{
+			p += 2;
+			return LineType::FACE;
+		}
+		return LineType::OTHER;
+	}
+
+	size_t countFaceCorners(const char* p, const char* end)
+	{
+		size_t count = 0;
+		for (p = skipSpace(p, end); p < end && *p != '\r'; p = skipSpace(p, end))
+		{
+			p = tokenEnd(p, end);
+			++count;
+		}
+		return count;
+	}
+
+	void countChunk(Chunk& chunk)
+	{
+		for (const char* line = chunk.begin; line < chunk.end;)
+		{
+			const char* end = lineEnd(line, chunk.end);
+			const char* p = line;
+			switch (classify(p, end))
+			{
+			case LineType::POSITION: ++chunk.positions; break;
+			case LineType::TEXCOORD: ++chunk.texcoords; break;
+			case LineType::NORMAL: ++chunk.normals; break;
+			case LineType::FACE:
+			{
+				const auto corners = countFaceCorners(p, end);
+				if (corners > 3)
+					chunk.unsupported = true;
+				else if (corners == 3)
+					chunk.corners += 3;
+				break;
+			}
+			default: break;
+			}
+			line = end + 1;
+		}
+	}
+
+	// Normals are only counted: the Vertex layout has no normal, but `vn` indices are part of
+	// the corner key and relative ones have to resolve against the right count.
+	void parseChunk(Chunk& chunk, std::vector<glm::vec3>& positions, std::vector<glm::vec2>& texcoords,
+		std::vector<CornerKey>& corners)
+	{
+		size_t position = chunk.positionBase;
+		size_t texcoord = chunk.texcoordBase;
+		size_t normal = chunk.normalBase;
+		size_t corner = chunk.cornerBase;
+
+		for (const char* line = chunk.begin; line < chunk.end;)
+		{
+			const char* end = lineEnd(line, chunk.end);
+			const char* p = line;
+			switch (classify(p, end))
+			{
+			case LineType::POSITION:
+			{
+				auto& v = positions[position++];
+				v.x = parseReal(p, end, 0.0);
+				v.y = parseReal(p, end, 0.0);
+				v.z = parseReal(p, end, 0.0);
+				break;
+			}
+			case LineType::TEXCOORD:
+			{
+				auto& vt = texcoords[texcoord++];
+				vt.x = parseReal(p, end, 0.0);
+				vt.y = parseReal(p, end, 0.0);
+				break;
+			}
+			case LineType::NORMAL: ++normal; break;
+			case LineType::FACE:
+			{
+				if (countFaceCorners(p, end) != 3)
+					break;
+				for (int i = 0; i < 3; ++i)
+				{
+					p = skipSpace(p, end);
+					CornerKey c{ fixIndex(parseIndex(p, end), position), -1, -1 };
+					if (p < end && *p == '/')
+					{
+						++p;
+						if (p < end && *p != '/')
+							c.texcoord = fixIndex(parseIndex(p, end), texcoord);
+						if (p < end && *p == '/')
+						{
+							++p;
+							c.normal = fixIndex(parseIndex(p, end), normal);
+						}
+					}
+					p = tokenEnd(p, end);
+					corners[corner++] = c;
+				}
+				break;
+			}
+			default: break;
+			}
+			line = end + 1;
+		}
+	}
+
+	std::vector<Chunk> splitChunks(const char* data, size_t size, size_t maxChunks)
+	{
+		const size_t count = std::clamp<size_t>(size / MIN_CHUNK_SIZE, 1, maxChunks);
+		std::vector<Chunk> chunks(count);
+		const char* begin = data;
+		const char* end = data + size;
+		for (size_t i = 0; i < count; ++i)
+		{
+			const char* split = end;
+			if (i + 1 < count)
+			{
+				split = lineEnd(std::max(begin, data + size * (i + 1) / count), end);
+				if (split < end)
+					++split;
+			}
+			chunks[i].begin = begin;
+			chunks[i].end = split;
+			begin = split;
+		}
+		return chunks;
+	}
+}
+
+bool loadObjParallel(const std::string& filename, MeshData& mesh, ThreadPool& pool, ObjLoadStats* stats /*= nullptr*/)
+{
+	PROFILE_ZONE("loadObjParallel");
+	MappedFile file;
+	if (!file.open(filename))
+	{
+		std::cerr << "Failed to load: " << filename << std::endl;
+		return false;
+	}
+
+	const unsigned participants = pool.size() + 1;
+	auto chunks = splitChunks(reinterpret_cast<const char*>(file.data()), file.size(), participants * 4);
+
+	// - pass 1: count records per chunk, then prefix-sum the counts into write offsets
+	pool.parallelFor(chunks.size(), [&](size_t i) { countChunk(chunks[i]); });
+
+	Chunk total;
+	for (auto& chunk : chunks)
+	{
+		if (chunk.unsupported)
+			return false;
+		chunk.positionBase = total.positions;
+		chunk.texcoordBase = total.texcoords;
+		chunk.normalBase = total.normals;
+		chunk.cornerBase = total.corners;
+		total.positions += chunk.positions;
+		total.texcoords += chunk.texcoords;
+		total.normals += chunk.normals;
+		total.corners += chunk.corners;
+	}
+
+	// - pass 2: parse every chunk straight into its slice of the merged arrays
+	std::vector<glm::vec3> positions(total.positions);
+	std::vector<glm::vec2> texcoords(total.texcoords);
+	std::vector<CornerKey> corners(total.corners);
+	pool.parallelFor(chunks.size(), [&](size_t i) { parseChunk(chunks[i], positions, texcoords, corners); });
+
+	const auto makeVertex = [&](const CornerKey& c) {
+		Vertex vertex{};
+		const auto& p = positions[c.position];
+		vertex.position = { p.x, p.y, p.z, 1.0f };
+		vertex.color = { 1.0f, 1.0f, 1.0f, 1.0f };
+		if (c.texcoord >= 0)
+			vertex.texcoord = texcoords[c.texcoord];
+		return vertex;
+	};
+
+	// - pass 3: bucket corners by shard, keeping file order inside every bucket. The shard comes
+	//   from the high hash bits because the shard maps index their slots with the low ones.
+	const size_t shardCount = participants;
+	std::vector<uint32_t> cornerShard(corners.size());
+	std::vector<std::vector<std::vector<uint32_t>>> buckets(chunks.size(), std::vector<std::vector<uint32_t>>(shardCount));
+	std::vector<char> invalid(chunks.size(), 0);
+	pool.parallelFor(chunks.size(), [&](size_t i) {
+		const auto& chunk = chunks[i];
+		for (size_t j = chunk.cornerBase; j < chunk.cornerBase + chunk.corners; ++j)
+		{
+			const auto& c = corners[j];
+			if (c.position < 0 || size_t(c.position) >= positions.size() ||
+				c.texcoord >= int32_t(texcoords.size()) || c.normal >= int32_t(total.normals))
+			{
+				invalid[i] = 1;
+				return;
+			}
+			const auto shard = static_cast<uint32_t>((CornerMap::hash(c) >> 32) % shardCount);
+			cornerShard[j] = shard;
+			buckets[i][shard].push_back(static_cast<uint32_t>(j));
+		}
+	});
+	if (std::find(invalid.begin(), invalid.end(), 1) != invalid.end())
+		return false;
+
+	// - pass 4: dedup each shard on its own; a corner that introduces a new vertex is marked
+	//   so the global numbering below can follow first-occurrence order like the serial path
+	std::vector<uint32_t> cornerLocal(corners.size());
+	std::vector<char> isFirst(corners.size(), 0);
+	std::vector<std::vector<uint32_t>> shardFirst(shardCount);
+	std::vector<CornerMapStats> shardStats(shardCount);
+	std::vector<size_t> shardBytes(shardCount);
+	pool.parallelFor(shardCount, [&](size_t shard) {
+		CornerMap unique(corners.size() / 3 / shardCount);
+		auto& first = shardFirst[shard];
+		for (const auto& bucket : buckets)
+		{
+			for (const auto j : bucket[shard])
+			{
+				const auto [local, inserted] = unique.insert(corners[j], static_cast<uint32_t>(first.size()));
+				if (inserted)
+				{
+					first.push_back(j);
+					isFirst[j] = 1;
+				}
+				cornerLocal[j] = local;
+			}
+		}
+		shardStats[shard] = unique.stats();
+		shardBytes[shard] = unique.memoryBytes();
+	});
+
+	if (stats)
+	{
+		*stats = {};
+		stats->threads = participants;
+		stats->peakBytes = file.size() + capacityBytes(positions) + capacityBytes(texcoords) + capacityBytes(corners) +
+			capacityBytes(cornerShard) + capacityBytes(cornerLocal) + capacityBytes(isFirst) +
+			// - cornerVertex, the output vertices and the output indices are allocated after this point
+			corners.size() * sizeof(uint32_t) * 3 + corners.size() / 3 * sizeof(Vertex);
+		for (size_t shard = 0; shard < shardCount; ++shard)
+		{
+			stats->dedup += shardStats[shard];
+			stats->peakBytes += shardBytes[shard] + capacityBytes(shardFirst[shard]);
+			for (const auto& bucket : buckets)
+				stats->peakBytes += capacityBytes(bucket[shard]);
+		}
+	}
+
+	// - pass 5: number the new vertices in file order and write them out
+	for (auto& chunk : chunks)
+	{
+		chunk.vertexBase = total.vertexBase;
+		for (size_t j = chunk.cornerBase; j < chunk.cornerBase + chunk.corners; ++j)
+			total.vertexBase += isFirst[j];
+	}
+
+	std::vector<uint32_t> cornerVertex(corners.size());
+	mesh.vertices.resize(total.vertexBase);
+	pool.parallelFor(chunks.size(), [&](size_t i) {
+		auto vertex = chunks[i].vertexBase;
+		for (size_t j = chunks[i].cornerBase; j < chunks[i].cornerBase + chunks[i].corners; ++j)
+		{
+			if (!isFirst[j])
+				continue;
+			cornerVertex[j] = static_cast<uint32_t>(vertex);
+			mesh.vertices[vertex++] = makeVertex(corners[j]);
+		}
+	});
+
+	// - pass 6: translate shard-local ids into the global numbering
+	std::vector<std::vector<uint32_t>> shardVertex(shardCount);
+	pool.parallelFor(shardCount, [&](size_t shard) {
+		const auto& first = shardFirst[shard];
+		shardVertex[shard].resize(first.size());
+		for (size_t k = 0; k < first.size(); ++k)
+			shardVertex[shard][k] = cornerVertex[first[k]];
+	});
+
+	mesh.indices.resize(corners.size());
+	pool.parallelFor(chunks.size(), [&](size_t i) {
+		for (size_t j = chunks[i].cornerBase; j < chunks[i].cornerBase + chunks[i].corners; ++j)
+			mesh.indices[j] = shardVertex[cornerShard[j]][cornerLocal[j]];
+	});
+
+	return true;
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <string>
+
+#include "mesh.h"
+
+class ThreadPool;
+
+// Parses an OBJ file in chunks split at line boundaries, one task per chunk, then deduplicates
+// the face corners (position/texcoord/normal index triples) with one hash shard per thread. The
+// result is identical to loadObj. Returns false for input it does not handle (polygons with more
+// than three corners, invalid indices) so the caller can fall back to loadObj.
+bool loadObjParallel(const std::string& filename, MeshData& mesh, ThreadPool& pool, ObjLoadStats* stats = nullptr);
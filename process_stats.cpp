@@ -0,0 +1,57 @@
+#include "process_stats.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <cstdio>
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+size_t currentResidentBytes()
+{
+	PROCESS_MEMORY_COUNTERS counters{};
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return 0;
+	return counters.WorkingSetSize;
+}
+
+size_t peakResidentBytes()
+{
+	PROCESS_MEMORY_COUNTERS counters{};
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return 0;
+	return counters.PeakWorkingSetSize;
+}
+
+#else
+
+size_t currentResidentBytes()
+{
+	FILE* file = std::fopen("/proc/self/statm", "r");
+	if (!file)
+		return 0;
+	unsigned long pages = 0;
+	const int read = std::fscanf(file, "%*s %lu", &pages);
+	std::fclose(file);
+	return read == 1 ? size_t(pages) * size_t(sysconf(_SC_PAGESIZE)) : 0;
+}
+
+size_t peakResidentBytes()
+{
+	rusage usage{};
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+		return 0;
+#ifdef __APPLE__
+	return size_t(usage.ru_maxrss);
+#else
+	return size_t(usage.ru_maxrss) * 1024;
+#endif
+}
+
+#endif
@@ -0,0 +1,7 @@
+#pragma once
+
+#include <cstddef>
+
+// Resident memory of the current process in bytes, 0 where the platform does not report it.
+size_t currentResidentBytes();
+size_t peakResidentBytes();
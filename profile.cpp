@@ -0,0 +1,188 @@
+#include "profile.h"
+
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <iomanip>
+#include <vector>
+
+#include "json.h"
+
+#if BUNNY_PROFILE
+
+namespace
+{
+	struct ProfileEvent
+	{
+		const char* name;
+		uint64_t start;
+		uint64_t end;
+	};
+
+	// - events per chunk; a thread allocates one more each time it fills the last
+	constexpr size_t PROFILE_CHUNK_EVENTS = 4096;
+
+	// Events of one thread. Only the owner appends; it publishes each event and each new chunk
+	// with a release store, so the exporter can read them from any thread while it keeps going.
+	struct EventChunk
+	{
+		std::array<ProfileEvent, PROFILE_CHUNK_EVENTS> events;
+		std::atomic<size_t> count{ 0 };
+		std::atomic<EventChunk*> next{ nullptr };
+	};
+
+	struct ThreadBuffer
+	{
+		uint32_t id = 0;
+		std::atomic<const char*> name{ nullptr };
+		EventChunk* first = nullptr;
+		// - owner only
+		EventChunk* last = nullptr;
+		size_t recorded = 0;
+		std::atomic<size_t> dropped{ 0 };
+		// - the next buffer registered before this one
+		ThreadBuffer* next = nullptr;
+	};
+
+	// - pushed to with a compare-exchange and never popped
+	std::atomic<ThreadBuffer*> threadBuffers{ nullptr };
+	std::atomic<uint32_t> threadCount{ 0 };
+
+	// - buffers are never freed: the trace is usually written after worker threads are gone
+	ThreadBuffer* registerThread()
+	{
+		auto buffer = new ThreadBuffer;
+		buffer->id = ++threadCount;
+		buffer->first = buffer->last = new EventChunk;
+		buffer->next = threadBuffers.load(std::memory_order_relaxed);
+		while (!threadBuffers.compare_exchange_weak(buffer->next, buffer, std::memory_order_release, std::memory_order_relaxed))
+		{
+		}
+		return buffer;
+	}
+
+	ThreadBuffer& threadBuffer()
+	{
+		thread_local ThreadBuffer* buffer = registerThread();
+		return *buffer;
+	}
+}
+
+void setProfiling(bool enabled)
+{
+	profile_detail::enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void setProfileThreadName(const char* name)
+{
+	threadBuffer().name.store(name, std::memory_order_release);
+}
+
+void recordProfileZone(const char* name, uint64_t start, uint64_t end)
+{
+	auto& buffer = threadBuffer();
+	if (buffer.recorded >= PROFILE_MAX_EVENTS_PER_THREAD)
+	{
+		buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	EventChunk* chunk = buffer.last;
+	size_t count = chunk->count.load(std::memory_order_relaxed);
+	if (count == PROFILE_CHUNK_EVENTS)
+	{
+		auto next = new EventChunk;
+		chunk->next.store(next, std::memory_order_release);
+		buffer.last = chunk = next;
+		count = 0;
+	}
+	chunk->events[count] = { name, start, end };
+	chunk->count.store(count + 1, std::memory_order_release);
+	++buffer.recorded;
+}
+
+bool writeChromeTrace(const std::string& filename)
+{
+	// - gather per thread, oldest registered first, then put time zero at the earliest zone
+	std::vector<ThreadBuffer*> buffers;
+	for (auto buffer = threadBuffers.load(std::memory_order_acquire); buffer; buffer = buffer->next)
+		buffers.push_back(buffer);
+	std::reverse(buffers.begin(), buffers.end());
+
+	std::vector<std::vector<ProfileEvent>> events(buffers.size());
+	uint64_t origin = UINT64_MAX;
+	for (size_t i = 0; i < buffers.size(); ++i)
+	{
+		for (auto chunk = buffers[i]->first; chunk; chunk = chunk->next.load(std::memory_order_acquire))
+		{
+			const size_t count = chunk->count.load(std::memory_order_acquire);
+			events[i].insert(events[i].end(), chunk->events.begin(), chunk->events.begin() + count);
+		}
+		// - zones end innermost first; sorting by start, longer first on ties, puts parents first
+		std::sort(events[i].begin(), events[i].end(), [](const ProfileEvent& a, const ProfileEvent& b) {
+			return a.start != b.start ? a.start < b.start : a.end > b.end;
+		});
+		if (!events[i].empty())
+			origin = std::min(origin, events[i].front().start);
+	}
+
+	std::ofstream out(filename, std::ios::trunc);
+	if (!out)
+		return false;
+
+	out << std::fixed << std::setprecision(3) << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+	bool first = true;
+	for (size_t i = 0; i < buffers.size(); ++i)
+	{
+		const uint32_t tid = buffers[i]->id;
+		if (const char* name = buffers[i]->name.load(std::memory_order_acquire))
+		{
+			out << (first ? "" : ",\n") << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << tid
+				<< ", \"args\": {\"name\": " << jsonString(name) << "}}";
+			first = false;
+		}
+		// - complete events, microseconds
+		for (const auto& event : events[i])
+		{
+			out << (first ? "" : ",\n") << "{\"name\": " << jsonString(event.name) << ", \"ph\": \"X\", \"pid\": 1, \"tid\": " << tid
+				<< ", \"ts\": " << (event.start - origin) / 1000.0 << ", \"dur\": " << (event.end - event.start) / 1000.0 << "}";
+			first = false;
+		}
+	}
+	out << "\n]}\n";
+	return bool(out);
+}
+
+size_t droppedProfileZones()
+{
+	size_t dropped = 0;
+	for (auto buffer = threadBuffers.load(std::memory_order_acquire); buffer; buffer = buffer->next)
+		dropped += buffer->dropped.load(std::memory_order_relaxed);
+	return dropped;
+}
+
+#else
+
+void setProfiling(bool)
+{
+}
+
+void setProfileThreadName(const char*)
+{
+}
+
+void recordProfileZone(const char*, uint64_t, uint64_t)
+{
+}
+
+bool writeChromeTrace(const std::string&)
+{
+	return false;
+}
+
+size_t droppedProfileZones()
+{
+	return 0;
+}
+
+#endif
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// - define to 0 to compile every PROFILE_ZONE out
+#ifndef BUNNY_PROFILE
+#define BUNNY_PROFILE 1
+#endif
+
+// - zones one thread keeps before it drops the rest
+constexpr size_t PROFILE_MAX_EVENTS_PER_THREAD = size_t(1) << 20;
+
+namespace profile_detail
+{
+	inline std::atomic<bool> enabled{ false };
+}
+
+// Zones are only recorded while profiling is on, so an idle zone costs one relaxed load.
+void setProfiling(bool enabled);
+
+inline bool profiling()
+{
+	return profile_detail::enabled.load(std::memory_order_relaxed);
+}
+
+// Names the calling thread in the trace; `name` must outlive the profiler.
+void setProfileThreadName(const char* name);
+
+// Nanoseconds on the clock zones are recorded with.
+inline uint64_t profileNow()
+{
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// Records the zone `name` (a string that outlives the profiler) on the calling thread, for spans
+// that do not fit a scope. Each thread appends to its own buffer, so this never takes a lock.
+void recordProfileZone(const char* name, uint64_t start, uint64_t end);
+
+// Zones recorded so far on every thread as Chrome trace_event JSON, for chrome://tracing or
+// Perfetto. Fails when profiling was compiled out.
+bool writeChromeTrace(const std::string& filename);
+
+// - zones dropped so far because their thread's buffer was full
+size_t droppedProfileZones();
+
+#if BUNNY_PROFILE
+
+// Records the enclosing scope as a zone.
+class ProfileZone
+{
+public:
+	explicit ProfileZone(const char* name)
+		: name_(name)
+		, start_(profiling() ? profileNow() : 0)
+	{
+	}
+
+	~ProfileZone()
+	{
+		if (start_)
+			recordProfileZone(name_, start_, profileNow());
+	}
+
+	ProfileZone(const ProfileZone&) = delete;
+	ProfileZone& operator=(const ProfileZone&) = delete;
+
+private:
+	const char* name_;
+	uint64_t start_;
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_ZONE(name) const ProfileZone PROFILE_CONCAT(profileZone, __LINE__)(name)
+
+#else
+
+#define PROFILE_ZONE(name) ((void)0)
+
+#endif
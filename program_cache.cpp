@@ -0,0 +1,151 @@
+#include "program_cache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+#include "mapped_file.h"
+#include "profile.h"
+
+namespace
+{
+	constexpr uint32_t PROGRAM_CACHE_MAGIC = 0x50594e42; // "BNYP"
+	constexpr uint32_t PROGRAM_CACHE_VERSION = 1;
+
+	struct ProgramCacheHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t binaryFormat;
+		uint32_t keySize;
+		uint64_t binarySize;
+	};
+
+	uint64_t fnv1a(std::string_view data)
+	{
+		uint64_t hash = 0xcbf29ce484222325ull;
+		for (const char c : data)
+		{
+			hash ^= static_cast<unsigned char>(c);
+			hash *= 0x100000001b3ull;
+		}
+		return hash;
+	}
+
+	std::string glString(GLenum name)
+	{
+		const auto value = reinterpret_cast<const char*>(glGetString(name));
+		return value ? value : "";
+	}
+}
+
+ProgramCache::ProgramCache(std::string directory)
+	: directory_(std::move(directory))
+{
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats_);
+	driver_ = glString(GL_VENDOR) + '\n' + glString(GL_RENDERER) + '\n' + glString(GL_VERSION) + '\n';
+	if (!directory_.empty() && formats_ == 0)
+		std::cout << "Program cache disabled, the driver offers no program binary formats\n";
+}
+
+std::string ProgramCache::key(std::span<const std::string_view> sources, std::string_view defines) const
+{
+	// - lengths in front of every part keep "ab" + "c" apart from "a" + "bc"
+	std::string key = driver_;
+	key += std::to_string(defines.size()) + ':';
+	key += defines;
+	for (const auto& source : sources)
+	{
+		key += std::to_string(source.size()) + ':';
+		key += source;
+	}
+	return key;
+}
+
+std::string ProgramCache::filename(const std::string& key) const
+{
+	char name[32];
+	std::snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(fnv1a(key)));
+	return (std::filesystem::path(directory_) / name).string();
+}
+
+GLuint ProgramCache::load(std::span<const std::string_view> sources, std::string_view defines /*= {}*/)
+{
+	if (!enabled())
+		return 0;
+
+	PROFILE_ZONE("ProgramCache::load");
+	const auto programKey = key(sources, defines);
+	MappedFile file;
+	ProgramCacheHeader header{};
+	bool valid = file.open(filename(programKey)) && file.size() >= sizeof(header);
+	if (valid)
+	{
+		std::memcpy(&header, file.data(), sizeof(header));
+		valid = header.magic == PROGRAM_CACHE_MAGIC && header.version == PROGRAM_CACHE_VERSION &&
+			header.keySize == programKey.size() && file.size() == sizeof(header) + header.keySize + header.binarySize &&
+			std::memcmp(file.data() + sizeof(header), programKey.data(), programKey.size()) == 0;
+	}
+	if (!valid)
+	{
+		++stats_.misses;
+		return 0;
+	}
+
+	// - separable has to be set before the binary is loaded, like before a link
+	GLuint program = glCreateProgram();
+	glProgramParameteri(program, GL_PROGRAM_SEPARABLE, GL_TRUE);
+	glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	glProgramBinary(program, header.binaryFormat, file.data() + sizeof(header) + header.keySize, GLsizei(header.binarySize));
+
+	GLint linked = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	if (!linked)
+	{
+		glDeleteProgram(program);
+		++stats_.rejected;
+		++stats_.misses;
+		return 0;
+	}
+	++stats_.hits;
+	return program;
+}
+
+bool ProgramCache::store(std::span<const std::string_view> sources, GLuint program, std::string_view defines /*= {}*/)
+{
+	if (!enabled())
+		return false;
+
+	PROFILE_ZONE("ProgramCache::store");
+	GLint linked = GL_FALSE;
+	GLint length = 0;
+	glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (!linked || length <= 0)
+		return false;
+
+	std::vector<std::byte> binary(static_cast<size_t>(length));
+	GLenum format = 0;
+	glGetProgramBinary(program, length, &length, &format, binary.data());
+
+	const auto programKey = key(sources, defines);
+	ProgramCacheHeader header{};
+	header.magic = PROGRAM_CACHE_MAGIC;
+	header.version = PROGRAM_CACHE_VERSION;
+	header.binaryFormat = format;
+	header.keySize = static_cast<uint32_t>(programKey.size());
+	header.binarySize = static_cast<uint64_t>(length);
+
+	std::error_code ec;
+	std::filesystem::create_directories(directory_, ec);
+
+	const std::span<const std::byte> parts[] = { std::as_bytes(std::span(&header, 1)), std::as_bytes(std::span(programKey)),
+		std::span(binary).first(static_cast<size_t>(length)) };
+	if (!writeFileReplacing(filename(programKey), parts))
+		return false;
+	++stats_.stored;
+	return true;
+}
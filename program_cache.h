@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+
+#include <glad/glad.h>
+
+// Linked program binaries kept on disk so later runs skip compiling and linking. Each program
+// gets its own file in the cache directory, named after a 64-bit FNV-1a hash of its sources, the
+// defines they were built with and the GL vendor, renderer and version strings; the header
+// repeats the full key so a hash collision or a driver update falls back to compiling.
+class ProgramCache
+{
+public:
+	struct Stats
+	{
+		size_t hits = 0;
+		size_t misses = 0;
+		// - binaries the driver refused to load, which then count as misses too
+		size_t rejected = 0;
+		size_t stored = 0;
+	};
+
+	// An empty directory turns the cache off; it is created on the first store.
+	explicit ProgramCache(std::string directory);
+
+	ProgramCache(const ProgramCache&) = delete;
+	ProgramCache& operator=(const ProgramCache&) = delete;
+
+	bool enabled() const { return !directory_.empty() && formats_ > 0; }
+
+	// A separable program restored from the binary cached for `sources` and `defines`, or 0 when
+	// there is none or the driver rejects it.
+	GLuint load(std::span<const std::string_view> sources, std::string_view defines = {});
+	// Saves the binary of a linked program; it should have been linked with
+	// GL_PROGRAM_BINARY_RETRIEVABLE_HINT set.
+	bool store(std::span<const std::string_view> sources, GLuint program, std::string_view defines = {});
+
+	const Stats& stats() const { return stats_; }
+
+private:
+	std::string key(std::span<const std::string_view> sources, std::string_view defines) const;
+	std::string filename(const std::string& key) const;
+
+	std::string directory_;
+	// - vendor, renderer and version, part of every key
+	std::string driver_;
+	GLint formats_ = 0;
+	Stats stats_;
+};
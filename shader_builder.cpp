@@ -0,0 +1,244 @@
+#include "shader_builder.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+#include "gl_extensions.h"
+#include "profile.h"
+
+namespace
+{
+	// - GL_KHR_parallel_shader_compile, missing from the glad headers
+	constexpr GLenum MAX_SHADER_COMPILER_THREADS_KHR = 0x91B0;
+	constexpr GLenum COMPLETION_STATUS_KHR = 0x91B1;
+	using MaxShaderCompilerThreadsProc = void (APIENTRYP)(GLuint count);
+
+	GLbitfield stageBit(GLenum type)
+	{
+		switch (type)
+		{
+		case GL_VERTEX_SHADER:      return GL_VERTEX_SHADER_BIT;
+		case GL_FRAGMENT_SHADER:    return GL_FRAGMENT_SHADER_BIT;
+		case GL_COMPUTE_SHADER:     return GL_COMPUTE_SHADER_BIT;
+		default:                    return 0;
+		}
+	}
+
+	// The glShaderSource parts of a stage: the source up to and including its #version line, the
+	// defines, the prelude, a #line that puts the numbering back where it was, and the rest of the
+	// source. `line` holds the #line directive the parts point into.
+	std::array<std::string_view, 5> sourceParts(std::string_view source, std::string_view defines, std::string_view prelude,
+		std::string& line)
+	{
+		size_t split = 0;
+		const auto version = source.find("#version");
+		if (version != std::string_view::npos)
+		{
+			const auto end = source.find('\n', version);
+			split = end == std::string_view::npos ? source.size() : end + 1;
+		}
+		const auto head = source.substr(0, split);
+		line = "#line " + std::to_string(std::count(head.begin(), head.end(), '\n') + 1) + '\n';
+		return { head, defines, prelude, line, source.substr(split) };
+	}
+
+	bool checkShader(GLuint shader)
+	{
+		GLint isCompiled = GL_FALSE;
+		glGetShaderiv(shader, GL_COMPILE_STATUS, &isCompiled);
+
+		GLint maxLength{};
+		glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &maxLength);
+
+		if (maxLength > 0
+#ifdef NDEBUG
+			&& isCompiled == GL_FALSE
+#endif // NDEBUG
+			)
+		{
+			std::vector<char> buffer(maxLength);
+			glGetShaderInfoLog(shader, maxLength, nullptr, buffer.data());
+
+			std::cout << "Error compiled:\n" << buffer.data() << '\n';
+		}
+		return isCompiled == GL_TRUE;
+	}
+
+	bool checkProgram(GLuint program)
+	{
+		GLint isLinked = GL_FALSE;
+		glGetProgramiv(program, GL_LINK_STATUS, &isLinked);
+
+		GLint maxLength{};
+		glGetProgramiv(program, GL_INFO_LOG_LENGTH, &maxLength);
+
+		if (maxLength > 0
+#ifdef NDEBUG
+			&& isLinked == GL_FALSE
+#endif // NDEBUG
+			)
+		{
+			std::vector<char> buffer(maxLength);
+			glGetProgramInfoLog(program, maxLength, nullptr, buffer.data());
+
+			std::cout << "Error linking:\n" << buffer.data() << '\n';
+		}
+		return isLinked == GL_TRUE;
+	}
+}
+
+ShaderBuilder::ShaderBuilder(ProgramCache* cache, GLADloadproc loader, std::string_view prelude /*= {}*/)
+	: cache_(cache)
+	, prelude_(prelude)
+{
+	// - the ARB extension is the same one under another name, with the same enums
+	const bool khr = hasExtension("GL_KHR_parallel_shader_compile");
+	if (khr || hasExtension("GL_ARB_parallel_shader_compile"))
+	{
+		const auto maxShaderCompilerThreads = reinterpret_cast<MaxShaderCompilerThreadsProc>(
+			loader(khr ? "glMaxShaderCompilerThreadsKHR" : "glMaxShaderCompilerThreadsARB"));
+		if (maxShaderCompilerThreads)
+		{
+			// - one per core; all ones would let the driver pick, but then it reports back all ones
+			maxShaderCompilerThreads(std::max(1u, std::thread::hardware_concurrency()));
+			GLint threads = 0;
+			glGetIntegerv(MAX_SHADER_COMPILER_THREADS_KHR, &threads);
+			compilerThreads_ = static_cast<unsigned>(threads);
+			parallel_ = true;
+		}
+	}
+}
+
+ShaderBuilder::~ShaderBuilder()
+{
+	for (auto& program : programs_)
+	{
+		for (const auto shader : program.shaders)
+			glDeleteShader(shader);
+		glDeleteProgramPipelines(1, &program.pipeline);
+		glDeleteProgram(program.program);
+	}
+}
+
+ShaderBuilder::Handle ShaderBuilder::add(std::span<const ShaderStage> stages, std::string defines /*= {}*/)
+{
+	PROFILE_ZONE("ShaderBuilder::add");
+	Program& program = programs_.emplace_back();
+	program.stages.assign(stages.begin(), stages.end());
+	program.defines = std::move(defines);
+
+	program.program = cache_ ? cache_->load(cacheSources(program), program.defines) : 0;
+	program.cached = program.program != 0;
+	if (program.cached)
+		return programs_.size() - 1;
+
+	program.program = glCreateProgram();
+	glProgramParameteri(program.program, GL_PROGRAM_SEPARABLE, GL_TRUE);
+	glProgramParameteri(program.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	for (const auto& stage : program.stages)
+	{
+		std::string line;
+		const auto parts = sourceParts(stage.source, program.defines, prelude_, line);
+		std::array<const GLchar*, parts.size()> strings;
+		std::array<GLint, parts.size()> lengths;
+		for (size_t i = 0; i < parts.size(); ++i)
+		{
+			strings[i] = parts[i].data();
+			lengths[i] = static_cast<GLint>(parts[i].size());
+		}
+		const GLuint shader = glCreateShader(stage.type);
+		glShaderSource(shader, GLsizei(parts.size()), strings.data(), lengths.data());
+		glCompileShader(shader);
+		glAttachShader(program.program, shader);
+		program.shaders.push_back(shader);
+	}
+	glLinkProgram(program.program);
+	return programs_.size() - 1;
+}
+
+void ShaderBuilder::poll()
+{
+	if (!parallel_)
+		return;
+
+	for (auto& program : programs_)
+	{
+		if (program.finished)
+			continue;
+		GLint complete = GL_FALSE;
+		glGetProgramiv(program.program, COMPLETION_STATUS_KHR, &complete);
+		if (complete)
+			this->complete(program, false);
+	}
+}
+
+size_t ShaderBuilder::pending() const
+{
+	size_t count = 0;
+	for (const auto& program : programs_)
+		count += program.finished ? 0 : 1;
+	return count;
+}
+
+void ShaderBuilder::complete(Program& program, bool blocking)
+{
+	PROFILE_ZONE("ShaderBuilder::complete");
+	const auto start = std::chrono::steady_clock::now();
+	bool linked = true;
+	if (program.cached)
+	{
+		++stats_.cached;
+	}
+	else
+	{
+		// - the first status query waits for the compile and link submitted in add()
+		for (const auto shader : program.shaders)
+			linked = checkShader(shader) && linked;
+		linked = checkProgram(program.program) && linked;
+		for (const auto shader : program.shaders)
+		{
+			glDetachShader(program.program, shader);
+			glDeleteShader(shader);
+		}
+		program.shaders.clear();
+
+		if (linked && cache_)
+			cache_->store(cacheSources(program), program.program, program.defines);
+		++(linked ? stats_.compiled : stats_.failed);
+	}
+
+	if (linked)
+	{
+		GLbitfield stages = 0;
+		for (const auto& stage : program.stages)
+			stages |= stageBit(stage.type);
+		glCreateProgramPipelines(1, &program.pipeline);
+		glUseProgramStages(program.pipeline, stages, program.program);
+	}
+	program.finished = true;
+	if (blocking)
+		stats_.blockedMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+std::vector<std::string_view> ShaderBuilder::cacheSources(const Program& program) const
+{
+	std::vector<std::string_view> sources{ prelude_ };
+	for (const auto& stage : program.stages)
+		sources.push_back(stage.source);
+	return sources;
+}
+
+ShaderBuilder::Handle ShaderVariants::prepare(uint32_t features)
+{
+	for (const auto& [mask, handle] : variants_)
+	{
+		if (mask == features)
+			return handle;
+	}
+	const auto handle = builder_.add(stages_, defines_(features));
+	variants_.emplace_back(features, handle);
+	return handle;
+}
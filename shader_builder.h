@@ -0,0 +1,143 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "program_cache.h"
+
+struct ShaderStage
+{
+	GLenum type;
+	// - GLSL text; it must outlive the builder since programs only compile when finished
+	std::string_view source;
+};
+
+// Separable programs and their pipelines, built without waiting on the driver. add() submits
+// every compile and the link without querying a status, so drivers compile in the background
+// (on their own threads with GL_KHR_parallel_shader_compile) while the caller goes on loading;
+// a program's statuses are only checked when it is first used, or earlier when poll() finds it
+// complete. Programs found in the ProgramCache skip compiling altogether.
+class ShaderBuilder
+{
+public:
+	using Handle = size_t;
+
+	struct Stats
+	{
+		size_t cached = 0;
+		size_t compiled = 0;
+		size_t failed = 0;
+		// - time spent in pipeline() and program() waiting for programs that were not complete yet
+		double blockedMs = 0.0;
+	};
+
+	// `loader` resolves the GL_KHR_parallel_shader_compile entry point, which glad does not load.
+	// `prelude` is GLSL shared by every program, inserted into each stage after its #defines; like
+	// the stage sources it has to outlive the builder.
+	ShaderBuilder(ProgramCache* cache, GLADloadproc loader, std::string_view prelude = {});
+	~ShaderBuilder();
+
+	ShaderBuilder(const ShaderBuilder&) = delete;
+	ShaderBuilder& operator=(const ShaderBuilder&) = delete;
+
+	// Starts building a program from one shader per stage: vertex and fragment, or compute.
+	// `defines` is inserted into every stage right after its #version line.
+	Handle add(std::span<const ShaderStage> stages, std::string defines = {});
+	Handle add(std::initializer_list<ShaderStage> stages, std::string defines = {})
+	{
+		return add(std::span<const ShaderStage>(stages.begin(), stages.size()), std::move(defines));
+	}
+
+	// Finishes the programs the driver reports complete, without blocking; only does anything
+	// with GL_KHR_parallel_shader_compile, since completion cannot be queried otherwise.
+	void poll();
+
+	// The program's pipeline and program, finishing it first if needed, which blocks until the
+	// driver is done with it. A program that failed to build has an empty pipeline.
+	GLuint pipeline(Handle handle)
+	{
+		finish(handle);
+		return programs_[handle].pipeline;
+	}
+
+	GLuint program(Handle handle)
+	{
+		finish(handle);
+		return programs_[handle].program;
+	}
+
+	size_t pending() const;
+	// - compiler threads the driver was asked for, 0 without GL_KHR_parallel_shader_compile
+	unsigned compilerThreads() const { return compilerThreads_; }
+	const Stats& stats() const { return stats_; }
+
+private:
+	struct Program
+	{
+		std::vector<ShaderStage> stages;
+		std::string defines;
+		// - shaders still attached until the program is finished
+		std::vector<GLuint> shaders;
+		GLuint program = 0;
+		GLuint pipeline = 0;
+		bool cached = false;
+		bool finished = false;
+	};
+
+	void finish(Handle handle)
+	{
+		if (!programs_[handle].finished)
+			complete(programs_[handle], true);
+	}
+
+	void complete(Program& program, bool blocking);
+	// - what the cache keys a program on: the prelude and the stage sources
+	std::vector<std::string_view> cacheSources(const Program& program) const;
+
+	ProgramCache* cache_;
+	std::string_view prelude_;
+	std::vector<Program> programs_;
+	bool parallel_ = false;
+	unsigned compilerThreads_ = 0;
+	Stats stats_;
+};
+
+// Variants of one program, built from the same stages under the #defines a feature mask maps to,
+// so each pass runs a program that only fetches and computes what it uses. A variant is
+// submitted to the builder by prepare(), or on its first pipeline() otherwise, and then reused.
+class ShaderVariants
+{
+public:
+	// - the #define lines for a feature mask
+	using Defines = std::string (*)(uint32_t features);
+
+	// `builder` has to outlive the variants.
+	ShaderVariants(ShaderBuilder& builder, std::initializer_list<ShaderStage> stages, Defines defines)
+		: builder_(builder), stages_(stages), defines_(defines)
+	{
+	}
+
+	ShaderVariants(const ShaderVariants&) = delete;
+	ShaderVariants& operator=(const ShaderVariants&) = delete;
+
+	ShaderBuilder::Handle prepare(uint32_t features);
+
+	GLuint pipeline(uint32_t features) { return builder_.pipeline(prepare(features)); }
+
+	size_t count() const { return variants_.size(); }
+
+private:
+	ShaderBuilder& builder_;
+	std::vector<ShaderStage> stages_;
+	Defines defines_;
+	// - feature mask and handle, looked up linearly since a program has only a few variants
+	std::vector<std::pair<uint32_t, ShaderBuilder::Handle>> variants_;
+};
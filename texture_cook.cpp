@@ -0,0 +1,191 @@
+#include "texture_cook.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+#define STB_IMAGE_RESIZE_IMPLEMENTATION
+#include <stb_image_resize.h>
+#define STB_DXT_IMPLEMENTATION
+#include <stb_dxt.h>
+
+#include "profile.h"
+
+namespace
+{
+	constexpr uint32_t TEXTURE_CACHE_MAGIC = 0x54594e42; // "BNYT"
+	constexpr uint32_t TEXTURE_CACHE_VERSION = 1;
+
+	struct TextureCacheHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t format;
+		uint32_t width;
+		uint32_t height;
+		uint32_t levels;
+		uint64_t sourceSize;
+		int64_t sourceTime;
+	};
+
+	// - texels per side of a compressed block
+	constexpr uint32_t BLOCK_SIZE = 4;
+
+	uint32_t blocks(uint32_t texels)
+	{
+		return (texels + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	}
+}
+
+uint32_t CookedTexture::levels() const
+{
+	return static_cast<uint32_t>(std::bit_width(std::max(width, height)));
+}
+
+uint32_t CookedTexture::levelWidth(uint32_t level) const
+{
+	return std::max(width >> level, 1u);
+}
+
+uint32_t CookedTexture::levelHeight(uint32_t level) const
+{
+	return std::max(height >> level, 1u);
+}
+
+size_t CookedTexture::levelSize(uint32_t level) const
+{
+	return size_t(blocks(levelWidth(level))) * blocks(levelHeight(level)) * blockBytes();
+}
+
+size_t CookedTexture::levelOffset(uint32_t level) const
+{
+	size_t offset = 0;
+	for (uint32_t i = 0; i < level; ++i)
+		offset += levelSize(i);
+	return offset;
+}
+
+CookedTexture cookTexture(const uint8_t* rgba, uint32_t width, uint32_t height, ThreadPool& pool)
+{
+	PROFILE_ZONE("cookTexture");
+	CookedTexture texture;
+	texture.width = width;
+	texture.height = height;
+
+	const size_t texels = size_t(width) * height;
+	bool opaque = true;
+	for (size_t i = 0; i < texels && opaque; ++i)
+		opaque = rgba[i * 4 + 3] == 255;
+	texture.format = opaque ? COMPRESSED_RGB_S3TC_DXT1 : COMPRESSED_RGBA_S3TC_DXT5;
+
+	// - RGBA8 levels below the first, each filtered down from the one above it
+	const uint32_t levelCount = texture.levels();
+	std::vector<std::vector<uint8_t>> mips(levelCount);
+	const auto levelTexels = [&](uint32_t level) { return level == 0 ? rgba : mips[level].data(); };
+	{
+		PROFILE_ZONE("mip chain");
+		for (uint32_t level = 1; level < levelCount; ++level)
+		{
+			const int w = int(texture.levelWidth(level));
+			const int h = int(texture.levelHeight(level));
+			mips[level].resize(size_t(w) * h * 4);
+			stbir_resize_uint8_srgb_edgemode(levelTexels(level - 1), int(texture.levelWidth(level - 1)), int(texture.levelHeight(level - 1)), 0,
+				mips[level].data(), w, h, 0, 4, 3, 0, STBIR_EDGE_WRAP);
+		}
+	}
+
+	// - one task per row of blocks, over every level at once so the small levels fill the gaps
+	struct BlockRow
+	{
+		uint32_t level;
+		uint32_t y;
+	};
+	std::vector<BlockRow> rows;
+	for (uint32_t level = 0; level < levelCount; ++level)
+	{
+		for (uint32_t y = 0; y < blocks(texture.levelHeight(level)); ++y)
+			rows.push_back({ level, y });
+	}
+
+	texture.data.resize(texture.levelOffset(levelCount));
+	const int alpha = opaque ? 0 : 1;
+	PROFILE_ZONE("compress blocks");
+	pool.parallelFor(rows.size(), [&](size_t i) {
+		const auto [level, by] = rows[i];
+		const uint32_t w = texture.levelWidth(level);
+		const uint32_t h = texture.levelHeight(level);
+		const uint8_t* source = levelTexels(level);
+		auto out = reinterpret_cast<unsigned char*>(texture.data.data() + texture.levelOffset(level)) +
+			size_t(by) * blocks(w) * texture.blockBytes();
+
+		// - blocks hanging over the edge repeat the last row and column
+		unsigned char block[BLOCK_SIZE * BLOCK_SIZE * 4];
+		for (uint32_t bx = 0; bx < blocks(w); ++bx)
+		{
+			for (uint32_t y = 0; y < BLOCK_SIZE; ++y)
+			{
+				const uint32_t sy = std::min(by * BLOCK_SIZE + y, h - 1);
+				for (uint32_t x = 0; x < BLOCK_SIZE; ++x)
+				{
+					const uint32_t sx = std::min(bx * BLOCK_SIZE + x, w - 1);
+					std::memcpy(block + (y * BLOCK_SIZE + x) * 4, source + (size_t(sy) * w + sx) * 4, 4);
+				}
+			}
+			stb_compress_dxt_block(out, block, alpha, STB_DXT_HIGHQUAL);
+			out += texture.blockBytes();
+		}
+	});
+	return texture;
+}
+
+bool openTextureCache(const std::string& filename, const FileStamp& source, MappedFile& file, CookedTexture& texture,
+	const std::byte*& levels)
+{
+	if (!file.open(filename) || file.size() < sizeof(TextureCacheHeader))
+		return false;
+
+	TextureCacheHeader header{};
+	std::memcpy(&header, file.data(), sizeof(header));
+	if (header.magic != TEXTURE_CACHE_MAGIC || header.version != TEXTURE_CACHE_VERSION ||
+		(header.format != COMPRESSED_RGB_S3TC_DXT1 && header.format != COMPRESSED_RGBA_S3TC_DXT5) ||
+		header.width == 0 || header.height == 0 ||
+		header.sourceSize != source.size || header.sourceTime != source.time)
+		return false;
+
+	texture.width = header.width;
+	texture.height = header.height;
+	texture.format = header.format;
+	const size_t size = texture.levelOffset(texture.levels());
+	if (header.levels != texture.levels() || file.size() != sizeof(header) + size)
+		return false;
+
+	levels = file.data() + sizeof(header);
+	return true;
+}
+
+bool readTextureCache(const std::string& filename, const FileStamp& source, CookedTexture& texture)
+{
+	MappedFile file;
+	const std::byte* levels = nullptr;
+	if (!openTextureCache(filename, source, file, texture, levels))
+		return false;
+
+	texture.data.assign(levels, levels + texture.levelOffset(texture.levels()));
+	return true;
+}
+
+bool writeTextureCache(const std::string& filename, const FileStamp& source, const CookedTexture& texture)
+{
+	TextureCacheHeader header{};
+	header.magic = TEXTURE_CACHE_MAGIC;
+	header.version = TEXTURE_CACHE_VERSION;
+	header.format = texture.format;
+	header.width = texture.width;
+	header.height = texture.height;
+	header.levels = texture.levels();
+	header.sourceSize = source.size;
+	header.sourceTime = source.time;
+
+	const std::span<const std::byte> parts[] = { std::as_bytes(std::span(&header, 1)), texture.data };
+	return writeFileReplacing(filename, parts);
+}
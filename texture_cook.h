@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "mapped_file.h"
+#include "thread_pool.h"
+
+// - GL_EXT_texture_compression_s3tc, missing from the glad headers
+constexpr GLenum COMPRESSED_RGB_S3TC_DXT1 = 0x83F0;
+constexpr GLenum COMPRESSED_RGBA_S3TC_DXT5 = 0x83F3;
+
+// A texture with its whole mip chain compressed to 4x4 blocks: BC1 (DXT1) when every texel is
+// opaque, BC3 (DXT5) otherwise.
+struct CookedTexture
+{
+	uint32_t width = 0;
+	uint32_t height = 0;
+	GLenum format = 0;
+	// - every level back to back, largest first, each a row-major array of blocks
+	std::vector<std::byte> data;
+
+	size_t blockBytes() const { return format == COMPRESSED_RGB_S3TC_DXT1 ? 8 : 16; }
+	uint32_t levels() const;
+	uint32_t levelWidth(uint32_t level) const;
+	uint32_t levelHeight(uint32_t level) const;
+	size_t levelSize(uint32_t level) const;
+	size_t levelOffset(uint32_t level) const;
+};
+
+// Builds the mip chain of `width` x `height` RGBA8 texels on the CPU, filtering in linear space
+// with wrapping edges, and compresses the levels block row by block row across the pool.
+CookedTexture cookTexture(const uint8_t* rgba, uint32_t width, uint32_t height, ThreadPool& pool);
+
+// Maps the texture cooked from `source` from `filename` and fills in everything but the data,
+// which starts at `levels` in the mapping; fails when it is missing or older than the source.
+bool openTextureCache(const std::string& filename, const FileStamp& source, MappedFile& file, CookedTexture& texture,
+	const std::byte*& levels);
+
+// Loads the texture cooked from `source` from `filename`, failing like openTextureCache.
+bool readTextureCache(const std::string& filename, const FileStamp& source, CookedTexture& texture);
+
+bool writeTextureCache(const std::string& filename, const FileStamp& source, const CookedTexture& texture);
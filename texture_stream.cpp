@@ -0,0 +1,312 @@
+#include "texture_stream.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <limits>
+
+#include <stb_image.h>
+
+#include "gl_extensions.h"
+#include "mapped_file.h"
+#include "profile.h"
+#include "texture_cook.h"
+#include "thread_pool.h"
+
+TextureStreamer::TextureStreamer(size_t frameBudget)
+	: frameBudget_(frameBudget)
+{
+	const uint32_t white = 0xffffffffu;
+	glCreateTextures(GL_TEXTURE_2D, 1, &placeholder_);
+	glTextureStorage2D(placeholder_, 1, GL_RGBA8, 1, 1);
+	glTextureSubImage2D(placeholder_, 0, 0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, &white);
+}
+
+TextureStreamer::~TextureStreamer()
+{
+	for (auto& texture : textures_)
+	{
+		// - the loader may still be writing into the staging buffer
+		if (texture.loader.valid())
+			texture.loader.wait();
+		release(texture);
+		glDeleteTextures(1, &texture.texture);
+	}
+	glDeleteTextures(1, &placeholder_);
+}
+
+TextureStreamer::Handle TextureStreamer::load(const std::string& filename, bool compress, bool useCache)
+{
+	PROFILE_ZONE("TextureStreamer::load");
+	Texture& texture = textures_.emplace_back();
+	texture.filename = filename;
+	const Handle handle = textures_.size() - 1;
+
+	if (compress && !hasExtension("GL_EXT_texture_compression_s3tc"))
+	{
+		std::cout << "Texture compression disabled, the driver lacks GL_EXT_texture_compression_s3tc\n";
+		compress = false;
+	}
+	texture.compressed = compress;
+
+	// - the staging buffer is sized from headers alone: the cached mip chain when there is one,
+	//   otherwise the image dimensions, as RGBA8 or as a BC3 chain, the larger of the two formats
+	FileStamp stamp;
+	useCache = compress && useCache && fileStamp(filename, stamp);
+	const auto cacheName = filename + ".bc";
+	MappedFile cache;
+	CookedTexture layout;
+	const std::byte* cachedLevels = nullptr;
+	const bool cached = useCache && openTextureCache(cacheName, stamp, cache, layout, cachedLevels);
+	size_t size = 0;
+	if (cached)
+	{
+		size = layout.levelOffset(layout.levels());
+	}
+	else
+	{
+		int w, h, c;
+		if (!stbi_info(filename.c_str(), &w, &h, &c))
+		{
+			std::cout << "Failed to load texture: " << filename << '\n';
+			texture.failed = true;
+			return handle;
+		}
+		layout.width = uint32_t(w);
+		layout.height = uint32_t(h);
+		layout.format = COMPRESSED_RGBA_S3TC_DXT5;
+		size = compress ? layout.levelOffset(layout.levels()) : size_t(w) * h * 4;
+	}
+
+	constexpr GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	glCreateBuffers(1, &texture.staging);
+	glNamedBufferStorage(texture.staging, GLsizeiptr(size), nullptr, flags);
+	texture.mapped = static_cast<std::byte*>(glMapNamedBufferRange(texture.staging, 0, GLsizeiptr(size), flags));
+	if (!texture.mapped)
+	{
+		std::cout << "Failed to map the staging buffer for texture: " << filename << '\n';
+		release(texture);
+		texture.failed = true;
+		return handle;
+	}
+
+	// - the buffer stays mapped while the loader writes; the GL thread only touches it again
+	//   once the future is ready
+	texture.loader = std::async(std::launch::async, [=, cache = std::move(cache), mapped = texture.mapped]() {
+		setProfileThreadName("texture loader");
+		PROFILE_ZONE("load texture");
+		const auto start = std::chrono::steady_clock::now();
+		Loaded loaded;
+		if (cached)
+		{
+			std::memcpy(mapped, cachedLevels, size);
+			loaded = { layout.format, layout.width, layout.height, true };
+		}
+		else
+		{
+			stbi_set_flip_vertically_on_load_thread(true);
+			int w, h, c;
+			stbi_uc* data = nullptr;
+			{
+				PROFILE_ZONE("stbi_load");
+				data = stbi_load(filename.c_str(), &w, &h, &c, STBI_rgb_alpha);
+			}
+			if (!data || uint32_t(w) != layout.width || uint32_t(h) != layout.height)
+			{
+				stbi_image_free(data);
+				return loaded;
+			}
+
+			if (compress)
+			{
+				const CookedTexture cooked = cookTexture(data, layout.width, layout.height, defaultThreadPool());
+				std::memcpy(mapped, cooked.data.data(), cooked.data.size());
+				if (useCache && !writeTextureCache(cacheName, stamp, cooked))
+					std::cerr << "Failed to write texture cache: " << cacheName << '\n';
+				loaded = { cooked.format, cooked.width, cooked.height, false };
+			}
+			else
+			{
+				std::memcpy(mapped, data, size);
+				loaded = { GL_RGBA8, layout.width, layout.height, false };
+			}
+			stbi_image_free(data);
+		}
+		loaded.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		return loaded;
+	});
+	return handle;
+}
+
+void TextureStreamer::update()
+{
+	PROFILE_ZONE("TextureStreamer::update");
+	const size_t budget = frameBudget_ > 0 ? frameBudget_ : std::numeric_limits<size_t>::max();
+	size_t uploaded = 0;
+	for (auto& texture : textures_)
+	{
+		if (texture.fence && glClientWaitSync(texture.fence, 0, 0) != GL_TIMEOUT_EXPIRED)
+			release(texture);
+		if (texture.failed)
+			continue;
+		if (!texture.texture && texture.loader.valid() && texture.loader.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+			begin(texture);
+		if (texture.texture && texture.levelsLeft > 0 && uploaded < budget)
+			uploaded += upload(texture, budget - uploaded);
+	}
+	if (uploaded > 0)
+	{
+		stats_.bytesUploaded += uploaded;
+		++stats_.uploadFrames;
+	}
+}
+
+void TextureStreamer::finish(Handle handle)
+{
+	Texture& texture = textures_[handle];
+	if (!texture.texture && texture.loader.valid())
+	{
+		PROFILE_ZONE("wait for texture loader");
+		texture.loader.wait();
+		begin(texture);
+	}
+	if (texture.texture && texture.levelsLeft > 0)
+		stats_.bytesUploaded += upload(texture, std::numeric_limits<size_t>::max());
+}
+
+GLuint TextureStreamer::texture(Handle handle) const
+{
+	const Texture& texture = textures_[handle];
+	return texture.texture && texture.levelsLeft < texture.levels.size() ? texture.texture : placeholder_;
+}
+
+bool TextureStreamer::complete(Handle handle) const
+{
+	const Texture& texture = textures_[handle];
+	return texture.texture && texture.levelsLeft == 0;
+}
+
+size_t TextureStreamer::pending() const
+{
+	size_t count = 0;
+	for (const auto& texture : textures_)
+		count += texture.failed || (texture.texture && texture.levelsLeft == 0) ? 0 : 1;
+	return count;
+}
+
+void TextureStreamer::begin(Texture& texture)
+{
+	texture.loaded = texture.loader.get();
+	if (texture.loaded.format == 0)
+	{
+		std::cout << "Failed to load texture: " << texture.filename << '\n';
+		release(texture);
+		texture.failed = true;
+		return;
+	}
+
+	// - compressed levels go up in rows of 4x4 blocks, RGBA8 in rows of texels
+	const auto& loaded = texture.loaded;
+	if (loaded.format == GL_RGBA8)
+	{
+		texture.levels.push_back({ loaded.width, loaded.height, 0, size_t(loaded.width) * 4, loaded.height, 1 });
+	}
+	else
+	{
+		CookedTexture layout;
+		layout.width = loaded.width;
+		layout.height = loaded.height;
+		layout.format = loaded.format;
+		for (uint32_t level = 0; level < layout.levels(); ++level)
+		{
+			const uint32_t w = layout.levelWidth(level);
+			const uint32_t h = layout.levelHeight(level);
+			texture.levels.push_back({ w, h, layout.levelOffset(level), size_t((w + 3) / 4) * layout.blockBytes(), (h + 3) / 4, 4 });
+		}
+	}
+
+	glCreateTextures(GL_TEXTURE_2D, 1, &texture.texture);
+	glTextureStorage2D(texture.texture, GLsizei(texture.levels.size()), loaded.format, GLsizei(loaded.width), GLsizei(loaded.height));
+	glTextureParameteri(texture.texture, GL_TEXTURE_MIN_FILTER, texture.levels.size() > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+	glTextureParameteri(texture.texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTextureParameteri(texture.texture, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTextureParameteri(texture.texture, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	texture.levelsLeft = texture.levels.size();
+	texture.row = 0;
+}
+
+size_t TextureStreamer::upload(Texture& texture, size_t budget)
+{
+	PROFILE_ZONE("upload texture");
+	const auto& loaded = texture.loaded;
+	size_t uploaded = 0;
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, texture.staging);
+	while (texture.levelsLeft > 0)
+	{
+		const size_t index = texture.levelsLeft - 1;
+		const Level& level = texture.levels[index];
+
+		// - whole rows only, and one row even when it alone is over the budget
+		size_t rows = (budget - uploaded) / level.rowBytes;
+		if (rows == 0)
+		{
+			if (uploaded > 0)
+				break;
+			rows = 1;
+		}
+		rows = std::min<size_t>(rows, level.rows - texture.row);
+
+		const uint32_t y = texture.row * level.texelsPerRow;
+		const uint32_t height = std::min(uint32_t(rows) * level.texelsPerRow, level.height - y);
+		const size_t bytes = rows * level.rowBytes;
+		const auto offset = reinterpret_cast<const void*>(level.offset + texture.row * level.rowBytes);
+		if (loaded.format == GL_RGBA8)
+		{
+			glTextureSubImage2D(texture.texture, GLint(index), 0, GLint(y), GLsizei(level.width), GLsizei(height), GL_RGBA,
+				GL_UNSIGNED_BYTE, offset);
+		}
+		else
+		{
+			glCompressedTextureSubImage2D(texture.texture, GLint(index), 0, GLint(y), GLsizei(level.width), GLsizei(height),
+				loaded.format, GLsizei(bytes), offset);
+		}
+		uploaded += bytes;
+		texture.row += uint32_t(rows);
+
+		// - a finished level becomes the base, so sampling never reaches one still partly uploaded
+		if (texture.row == level.rows)
+		{
+			texture.row = 0;
+			--texture.levelsLeft;
+			glTextureParameteri(texture.texture, GL_TEXTURE_BASE_LEVEL, GLint(texture.levelsLeft));
+		}
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	++texture.uploadFrames;
+
+	if (texture.levelsLeft == 0)
+	{
+		texture.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		const char* const format = loaded.format == GL_RGBA8 ? "RGBA8" : loaded.format == COMPRESSED_RGB_S3TC_DXT1 ? "BC1" : "BC3";
+		size_t total = 0;
+		for (const auto& level : texture.levels)
+			total += level.rows * level.rowBytes;
+		std::cout << (loaded.cached ? "Loaded " : loaded.format == GL_RGBA8 ? "Decoded " : "Cooked ") << loaded.width << "x"
+			<< loaded.height << " " << format << " texture, " << texture.levels.size() << " levels, " << total / 1024
+			<< " KiB (RGBA8 without mipmaps: " << size_t(loaded.width) * loaded.height * 4 / 1024 << " KiB) in "
+			<< loaded.milliseconds << " ms on a loader thread, uploaded over " << texture.uploadFrames << " frames\n";
+	}
+	return uploaded;
+}
+
+void TextureStreamer::release(Texture& texture)
+{
+	if (texture.fence)
+		glDeleteSync(texture.fence);
+	// - deleting a buffer unmaps it
+	glDeleteBuffers(1, &texture.staging);
+	texture.fence = nullptr;
+	texture.staging = 0;
+	texture.mapped = nullptr;
+}
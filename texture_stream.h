@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+
+// Textures loaded off the GL thread and uploaded a slice per frame. load() only reads the image
+// header and maps a staging GL_PIXEL_UNPACK_BUFFER sized for it; a loader thread decodes the
+// image, or reads or cooks its BC1/BC3 mip chain, into that persistently mapped buffer. update()
+// then copies at most the frame budget from the buffer into the texture, smallest level first
+// and rows of a level at a time, so a big texture streams in over several frames and is sampled
+// from its smallest complete level meanwhile instead of stalling a frame.
+class TextureStreamer
+{
+public:
+	using Handle = size_t;
+
+	struct Stats
+	{
+		size_t bytesUploaded = 0;
+		// - update() calls that uploaded anything
+		size_t uploadFrames = 0;
+	};
+
+	// At most `frameBudget` bytes are uploaded per update(), 0 for no limit; each update still
+	// uploads at least one row of texels or blocks so streaming always moves forward.
+	explicit TextureStreamer(size_t frameBudget);
+	~TextureStreamer();
+
+	TextureStreamer(const TextureStreamer&) = delete;
+	TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+	// Starts loading `filename`, flipped for OpenGL, as a BC1/BC3 mip chain cooked through the
+	// <filename>.bc cache (written and read only with `useCache`) when `compress` is set and the
+	// driver supports it, as a single RGBA8 level otherwise.
+	Handle load(const std::string& filename, bool compress, bool useCache);
+
+	// Uploads what the budget allows from the textures whose loader finished, and releases the
+	// staging buffers the GPU is done reading.
+	void update();
+
+	// Waits for the loader and uploads the rest of the texture regardless of the budget.
+	void finish(Handle handle);
+
+	// The texture to bind: a white texel until the smallest level has arrived.
+	GLuint texture(Handle handle) const;
+	bool complete(Handle handle) const;
+	// - whether the texture is a BC1/BC3 chain rather than RGBA8, known as soon as load() returns
+	bool compressed(Handle handle) const { return textures_[handle].compressed; }
+	// - textures still loading or uploading
+	size_t pending() const;
+	const Stats& stats() const { return stats_; }
+
+private:
+	// - what the loader thread put in the staging buffer, format 0 when it failed
+	struct Loaded
+	{
+		GLenum format = 0;
+		uint32_t width = 0;
+		uint32_t height = 0;
+		bool cached = false;
+		double milliseconds = 0.0;
+	};
+
+	struct Level
+	{
+		uint32_t width;
+		uint32_t height;
+		size_t offset;
+		// - bytes per row of texels, or of blocks for a compressed level
+		size_t rowBytes;
+		uint32_t rows;
+		uint32_t texelsPerRow;
+	};
+
+	struct Texture
+	{
+		std::string filename;
+		bool compressed = false;
+		std::future<Loaded> loader;
+		GLuint staging = 0;
+		std::byte* mapped = nullptr;
+		Loaded loaded;
+		// - created once the loader is done
+		GLuint texture = 0;
+		std::vector<Level> levels;
+		// - levels not uploaded yet; they go smallest first, so the next upload is to level
+		//   levelsLeft - 1 from `row` on
+		size_t levelsLeft = 0;
+		uint32_t row = 0;
+		// - update() calls that uploaded part of this texture
+		size_t uploadFrames = 0;
+		// - set after the last upload; the staging buffer goes once it is signaled
+		GLsync fence = nullptr;
+		bool failed = false;
+	};
+
+	void begin(Texture& texture);
+	// - uploads up to `budget` bytes, returns how many were uploaded
+	size_t upload(Texture& texture, size_t budget);
+	void release(Texture& texture);
+
+	size_t frameBudget_;
+	GLuint placeholder_ = 0;
+	std::vector<Texture> textures_;
+	Stats stats_;
+};
@@ -0,0 +1,83 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <atomic>
+
+#include "profile.h"
+
+ThreadPool::ThreadPool(unsigned threadCount)
+{
+	threadCount = std::max(threadCount, 1u);
+	workers_.reserve(threadCount);
+	for (unsigned i = 0; i < threadCount; ++i)
+	{
+		workers_.emplace_back([this]() { run(); });
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stopping_ = true;
+	}
+	condition_.notify_all();
+	for (auto& worker : workers_)
+	{
+		worker.join();
+	}
+}
+
+void ThreadPool::run()
+{
+	setProfileThreadName("pool worker");
+	for (;;)
+	{
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			condition_.wait(lock, [this]() { return stopping_ || !tasks_.empty(); });
+			if (tasks_.empty())
+				return;
+			task = std::move(tasks_.front());
+			tasks_.pop();
+		}
+		PROFILE_ZONE("pool task");
+		task();
+	}
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)>& task)
+{
+	if (count == 0)
+		return;
+
+	// - every participant pulls the next index from a shared counter, so uneven items balance out
+	std::atomic<size_t> next{ 0 };
+	const auto drain = [&]() {
+		for (size_t i = next++; i < count; i = next++)
+		{
+			task(i);
+		}
+	};
+
+	const size_t helpers = std::min<size_t>(size(), count - 1);
+	std::vector<std::future<void>> pending;
+	pending.reserve(helpers);
+	for (size_t i = 0; i < helpers; ++i)
+	{
+		pending.push_back(submit(drain));
+	}
+
+	drain();
+	for (auto& future : pending)
+	{
+		future.get();
+	}
+}
+
+ThreadPool& defaultThreadPool()
+{
+	static ThreadPool pool;
+	return pool;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Fixed set of worker threads fed from a single FIFO queue.
+class ThreadPool
+{
+public:
+	explicit ThreadPool(unsigned threadCount = std::thread::hardware_concurrency());
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	unsigned size() const { return static_cast<unsigned>(workers_.size()); }
+
+	template<typename F>
+	auto submit(F&& task) -> std::future<std::invoke_result_t<F>>
+	{
+		using result_t = std::invoke_result_t<F>;
+		auto packaged = std::make_shared<std::packaged_task<result_t()>>(std::forward<F>(task));
+		auto future = packaged->get_future();
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			tasks_.emplace([packaged]() { (*packaged)(); });
+		}
+		condition_.notify_one();
+		return future;
+	}
+
+	// Calls task(i) for every i in [0, count) on the workers and the calling thread and
+	// returns once all calls are done. Must not be called from inside a pool task.
+	void parallelFor(size_t count, const std::function<void(size_t)>& task);
+
+private:
+	void run();
+
+	std::vector<std::thread> workers_;
+	std::queue<std::function<void()>> tasks_;
+	std::mutex mutex_;
+	std::condition_variable condition_;
+	bool stopping_ = false;
+};
+
+// Process-wide pool sized to the number of hardware threads.
+ThreadPool& defaultThreadPool();
@@ -0,0 +1,99 @@
+#include "upload_ring.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+#include "profile.h"
+
+namespace
+{
+	size_t alignUp(size_t value, size_t alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+}
+
+UploadRing::UploadRing(size_t frameBytes)
+{
+	GLint uniformAlignment = 1;
+	GLint storageAlignment = 1;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformAlignment);
+	glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &storageAlignment);
+	alignment_ = static_cast<size_t>(std::max({ uniformAlignment, storageAlignment, GLint(16) }));
+	frameBytes_ = alignUp(frameBytes, alignment_);
+
+	const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	const auto size = static_cast<GLsizeiptr>(frameBytes_ * FRAMES_IN_FLIGHT);
+	glCreateBuffers(1, &buffer_);
+	glNamedBufferStorage(buffer_, size, nullptr, flags);
+	mapped_ = static_cast<std::byte*>(glMapNamedBufferRange(buffer_, 0, size, flags));
+	if (!mapped_)
+		std::cerr << "Failed to map upload ring of " << size << " bytes\n";
+}
+
+UploadRing::~UploadRing()
+{
+	for (auto& fence : fences_)
+	{
+		if (fence)
+			glDeleteSync(fence);
+	}
+	if (mapped_)
+		glUnmapNamedBuffer(buffer_);
+	glDeleteBuffers(1, &buffer_);
+}
+
+void UploadRing::beginFrame()
+{
+	PROFILE_ZONE("UploadRing::beginFrame");
+	frame_ = (frame_ + 1) % FRAMES_IN_FLIGHT;
+	used_ = 0;
+
+	auto& fence = fences_[frame_];
+	if (!fence)
+		return;
+
+	GLenum result = glClientWaitSync(fence, 0, 0);
+	if (result == GL_TIMEOUT_EXPIRED)
+	{
+		// - the GPU is FRAMES_IN_FLIGHT frames behind; flush so the fence can signal at all
+		const auto start = std::chrono::steady_clock::now();
+		do
+		{
+			result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+		} while (result == GL_TIMEOUT_EXPIRED);
+		++stats_.stalls;
+		stats_.stallMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+	if (result == GL_WAIT_FAILED)
+		std::cerr << "Upload ring fence wait failed\n";
+
+	glDeleteSync(fence);
+	fence = nullptr;
+}
+
+void UploadRing::endFrame()
+{
+	fences_[frame_] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+UploadRing::Allocation UploadRing::allocate(size_t bytes)
+{
+	const size_t offset = alignUp(used_, alignment_);
+	if (!mapped_ || offset + bytes > frameBytes_)
+	{
+		std::cerr << "Upload ring frame region of " << frameBytes_ << " bytes cannot fit " << bytes << " more bytes\n";
+		return {};
+	}
+
+	used_ = offset + bytes;
+	stats_.peakFrameBytes = std::max(stats_.peakFrameBytes, used_);
+	const size_t absolute = frame_ * frameBytes_ + offset;
+	return { mapped_ + absolute, static_cast<GLintptr>(absolute), static_cast<GLsizeiptr>(bytes) };
+}
+
+void UploadRing::bindRange(GLenum target, GLuint index, const Allocation& allocation) const
+{
+	glBindBufferRange(target, index, buffer_, allocation.offset, allocation.size);
+}
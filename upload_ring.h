@@ -0,0 +1,75 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include <glad/glad.h>
+
+// - frames the CPU may record ahead of the GPU before it has to wait on a fence
+constexpr unsigned FRAMES_IN_FLIGHT = 3;
+
+// Per-frame upload allocator over one persistently mapped, coherent buffer split into
+// FRAMES_IN_FLIGHT regions. A region is only written again once the fence placed after the
+// frame that last used it has signaled, so uploads never map, unmap or stall the driver.
+class UploadRing
+{
+public:
+	struct Allocation
+	{
+		void* data = nullptr;
+		GLintptr offset = 0;
+		GLsizeiptr size = 0;
+		explicit operator bool() const { return data != nullptr; }
+	};
+
+	struct Stats
+	{
+		// - frames that found their region still in use by the GPU
+		size_t stalls = 0;
+		double stallMs = 0.0;
+		// - most bytes one frame allocated so far
+		size_t peakFrameBytes = 0;
+	};
+
+	// Creates the buffer; allocations are aligned to the larger of the uniform and storage buffer
+	// offset alignments so any of them can be bound with glBindBufferRange.
+	explicit UploadRing(size_t frameBytes);
+	~UploadRing();
+
+	UploadRing(const UploadRing&) = delete;
+	UploadRing& operator=(const UploadRing&) = delete;
+
+	// Waits until the GPU is done with the next region and starts allocating from it.
+	void beginFrame();
+	// Fences the commands that read this frame's region.
+	void endFrame();
+
+	// Returns an empty allocation when the frame region is full.
+	Allocation allocate(size_t bytes);
+
+	template<typename T>
+	T* allocate(Allocation& allocation, size_t count = 1)
+	{
+		allocation = allocate(sizeof(T) * count);
+		return static_cast<T*>(allocation.data);
+	}
+
+	void bindRange(GLenum target, GLuint index, const Allocation& allocation) const;
+
+	GLuint buffer() const { return buffer_; }
+	// - region in use since the last beginFrame(), for per-frame state kept next to the ring
+	unsigned frameIndex() const { return frame_; }
+	size_t frameBytes() const { return frameBytes_; }
+	const Stats& stats() const { return stats_; }
+
+private:
+	GLuint buffer_ = 0;
+	std::byte* mapped_ = nullptr;
+	size_t frameBytes_ = 0;
+	size_t alignment_ = 1;
+	unsigned frame_ = 0;
+	size_t used_ = 0;
+	std::array<GLsync, FRAMES_IN_FLIGHT> fences_{};
+	Stats stats_;
+};